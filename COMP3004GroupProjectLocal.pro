@@ -8,22 +8,19 @@ CONFIG += c++11
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Catalogue, controller and persistence (shared with server/ and tools/)
+include(core.pri)
+
 SOURCES += \
-    catalogue.cpp \
-    item.cpp \
-    librarycontroller.cpp \
+    itemtablemodel.cpp \
     logindialog.cpp \
     main.cpp \
-    mainwindow.cpp \
-    user.cpp
+    mainwindow.cpp
 
 HEADERS += \
-    catalogue.h \
-    item.h \
-    librarycontroller.h \
+    itemtablemodel.h \
     logindialog.h \
-    mainwindow.h \
-    user.h
+    mainwindow.h
 
 FORMS += \
     mainwindow.ui
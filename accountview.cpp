@@ -0,0 +1,109 @@
+#include "accountview.h"
+#include "cataloguesnapshot.h"
+#include "availabilityforecast.h"
+
+void AccountViews::fillLoan(const CatalogueSnapshot& snap, LoanRow& row, const QDate& today) const {
+    const Item* it = snap.findItem(row.itemId);
+    row.title = it ? it->title : QString();
+    row.due = it ? it->due : QDate();
+    row.daysLeft = row.due.isValid() ? int(today.daysTo(row.due)) : 0;
+}
+
+void AccountViews::fillHold(const CatalogueSnapshot& snap, HoldRow& row, int userId, const QDate& today) const {
+    const Item* it = snap.findItem(row.itemId);
+    row.title = it ? it->title : QString();
+    const int idx = it ? it->holdQueue.indexOf(userId) : -1;
+    row.position = idx >= 0 ? idx + 1 : -1;
+    row.expected = forecast_ && idx >= 0 ? forecast_->expected(*it, row.position, today) : QDate();
+}
+
+const QVector<LoanRow>& AccountViews::loans(const CatalogueSnapshot& snap, int userId, const QDate& today) {
+    View& v = views_[userId];
+    if (v.loansStale) {
+        v.loans.clear();
+        if (const User* u = snap.findUserById(userId)) {
+            for (int itemId : u->loans) {
+                if (!snap.findItem(itemId)) continue;
+                LoanRow row;
+                row.itemId = itemId;
+                v.loans.append(row);
+            }
+        }
+        v.loanDirty.fill(true, v.loans.size());
+        v.loansStale = false;
+    }
+    for (int i = 0; i < v.loans.size(); ++i) {
+        if (!v.loanDirty.at(i)) continue;
+        fillLoan(snap, v.loans[i], today);
+        v.loanDirty[i] = false;
+    }
+    if (v.today != today) {
+        for (auto& row : v.loans) row.daysLeft = row.due.isValid() ? int(today.daysTo(row.due)) : 0;
+        v.today = today;
+    }
+    return v.loans;
+}
+
+const QVector<HoldRow>& AccountViews::holds(const CatalogueSnapshot& snap, int userId, const QDate& today) {
+    View& v = views_[userId];
+    const quint64 gen = forecast_ ? forecast_->generation() : 0;
+    if (forecast_ && (v.holdsToday != today || v.forecastGen != gen)) {
+        v.holdDirty.fill(true);
+        v.holdsToday = today;
+        v.forecastGen = gen;
+    }
+    if (v.holdsStale) {
+        v.holds.clear();
+        if (const User* u = snap.findUserById(userId)) {
+            for (int itemId : u->holds) {
+                if (!snap.findItem(itemId)) continue;
+                HoldRow row;
+                row.itemId = itemId;
+                v.holds.append(row);
+            }
+        }
+        v.holdDirty.fill(true, v.holds.size());
+        v.holdsStale = false;
+    }
+    for (int i = 0; i < v.holds.size(); ++i) {
+        if (!v.holdDirty.at(i)) continue;
+        fillHold(snap, v.holds[i], userId, today);
+        v.holdDirty[i] = false;
+    }
+    return v.holds;
+}
+
+// A user's own borrow/return or hold/cancel changes which rows exist. Anyone
+// else's only touches rows for the items involved: a loan's due date, or a
+// hold's place in a queue that moved.
+void AccountViews::invalidate(const ChangeSet& changes) {
+    for (auto v = views_.begin(); v != views_.end(); ++v) {
+        const int userId = v.key();
+        View& view = v.value();
+        if (ChangeSet::has(changes.loanUsers, userId)) {
+            view.loansStale = true;
+        } else if (!changes.items.isEmpty()) {
+            for (int i = 0; i < view.loans.size(); ++i)
+                if (ChangeSet::has(changes.items, view.loans.at(i).itemId)) view.loanDirty[i] = true;
+        }
+        if (ChangeSet::has(changes.holdUsers, userId)) {
+            view.holdsStale = true;
+        } else if (!changes.holdItems.isEmpty() || !changes.items.isEmpty()) {
+            for (int i = 0; i < view.holds.size(); ++i) {
+                const int itemId = view.holds.at(i).itemId;
+                if (ChangeSet::has(changes.holdItems, itemId) || ChangeSet::has(changes.items, itemId))
+                    view.holdDirty[i] = true;
+            }
+        }
+    }
+}
+
+bool AccountViews::isStale(int userId, const QDate& today) const {
+    auto found = views_.constFind(userId);
+    if (found == views_.constEnd()) return true;
+    const View& v = found.value();
+    if (v.loansStale || v.holdsStale || (v.today != today && !v.loans.isEmpty())) return true;
+    if (forecast_ && (v.holdsToday != today || v.forecastGen != forecast_->generation())
+            && !v.holds.isEmpty()) return true;
+    return v.loanDirty.contains(true) || v.holdDirty.contains(true);
+}
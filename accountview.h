@@ -0,0 +1,79 @@
+#ifndef ACCOUNTVIEW_H
+#define ACCOUNTVIEW_H
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QDate>
+#include "changeset.h"
+
+class CatalogueSnapshot;
+class AvailabilityForecast;
+
+// One row of the "My loans" panel.
+struct LoanRow {
+    int itemId = -1;
+    QString title;
+    QDate due;
+    int daysLeft = 0;     // from the date passed to loans()
+};
+
+// One row of the "My holds" panel.
+struct HoldRow {
+    int itemId = -1;
+    QString title;
+    int position = -1;    // 1-based place in the item's queue; -1 if not queued
+    QDate expected;       // see AvailabilityForecast; invalid without one
+};
+
+// Materialized account panels, per user. Rows are built on first display and
+// then kept; ChangeSets from the controller mark exactly the rows they can
+// affect (a user's loan or hold list, one item's title/due date, one item's
+// queue positions) and only those are recomputed the next time the panel is
+// read. Days left and expected dates are refreshed in place when the date
+// moves on, and expected dates also when the forecast's average does.
+//
+// Rows are read from a CatalogueSnapshot, so building them takes no lock and
+// never waits on a running command. Pass one at least as new as the last
+// ChangeSet given to invalidate().
+class AccountViews {
+public:
+
+    // Fills HoldRow::expected when set. Not owned.
+    void setForecast(const AvailabilityForecast* forecast) { forecast_ = forecast; views_.clear(); }
+
+    // The user's rows, recomputing only what was marked. The reference is
+    // good until the next call on this object.
+    const QVector<LoanRow>& loans(const CatalogueSnapshot& snap, int userId, const QDate& today);
+    const QVector<HoldRow>& holds(const CatalogueSnapshot& snap, int userId, const QDate& today);
+
+    // Marks every cached row that `changes` (normalized, as the controller
+    // and ChangeBus deliver it) may have altered.
+    void invalidate(const ChangeSet& changes);
+    // Forget everything, e.g. after the catalogue was reloaded or imported.
+    void clear() { views_.clear(); }
+
+    // Would loans()/holds() for userId recompute anything?
+    bool isStale(int userId, const QDate& today) const;
+
+private:
+    struct View {
+        bool loansStale = true;      // the list itself, not just some rows
+        bool holdsStale = true;
+        QDate today;                 // what daysLeft was counted from
+        QDate holdsToday;            // what expected dates were forecast from
+        quint64 forecastGen = 0;     // ... and with which AvailabilityForecast::generation()
+        QVector<LoanRow> loans;
+        QVector<HoldRow> holds;
+        QVector<bool> loanDirty;     // per row
+        QVector<bool> holdDirty;
+    };
+
+    void fillLoan(const CatalogueSnapshot& snap, LoanRow& row, const QDate& today) const;
+    void fillHold(const CatalogueSnapshot& snap, HoldRow& row, int userId, const QDate& today) const;
+
+    const AvailabilityForecast* forecast_ = nullptr;
+    QHash<int, View> views_;         // user id -> view
+};
+
+#endif // ACCOUNTVIEW_H
@@ -0,0 +1,94 @@
+#include "availabilityforecast.h"
+#include "catalogue.h"
+#include "librarycontroller.h"
+#include "itempolicy.h"
+#include <QMutexLocker>
+
+static const double kWeight = 1.0 / 32;   // a finished loan's share of the average
+
+static QDate forecast(const Item& it, int position, const QDate& today, double meanDays) {
+    const int ahead = (position > 0 ? position : it.holdQueue.size() + 1) - 1;
+    QDate free = today;
+    if (it.status == Availability::CheckedOut && it.due.isValid()) {
+        const QDate start = it.due.addDays(-itemTypeInfo(it.type).loanDays);
+        free = qBound(today, start.addDays(qRound(meanDays)), qMax(today, it.due));
+    }
+    return free.addDays(qRound(ahead * meanDays));
+}
+
+AvailabilityForecast::AvailabilityForecast(const Catalogue* cat)
+    : cat_(cat), meanLoanDays_(LibraryController::kLoanDays) {}
+
+void AvailabilityForecast::attach(LibraryController* lib) {
+    lib->subscribe([this, lib](const ChangeSet& changes){ observe(changes, lib->today()); });
+}
+
+// A loan is seen to start when its item shows up checked out, and to end
+// when the same item shows up available again. This runs on whichever
+// thread ran the command, with other commands writing items, so it looks
+// at a snapshot rather than the live records.
+void AvailabilityForecast::observe(const ChangeSet& changes, const QDate& today) {
+    if (changes.items.isEmpty()) return;
+    const CatalogueSnapshot snap = cat_->snapshot();
+    QMutexLocker locker(&lock_);
+    for (int id : changes.items) {
+        const Item* it = snap.findItem(id);
+        if (it && it->status == Availability::CheckedOut) {
+            onLoan_.insert(id, it->due.addDays(-itemTypeInfo(it->type).loanDays));
+            continue;
+        }
+        auto found = onLoan_.find(id);
+        if (found == onLoan_.end()) continue;
+        if (it) {
+            const double held = qMax<qint64>(0, found.value().daysTo(today));
+            const double mean = meanLoanDays_ + (held - meanLoanDays_) * kWeight;
+            if (mean != meanLoanDays_) ++generation_;
+            meanLoanDays_ = mean;
+        }
+        onLoan_.erase(found);
+    }
+}
+
+double AvailabilityForecast::meanLoanDays() const {
+    QMutexLocker locker(&lock_);
+    return meanLoanDays_;
+}
+
+quint64 AvailabilityForecast::generation() const {
+    QMutexLocker locker(&lock_);
+    return generation_;
+}
+
+QDate AvailabilityForecast::expected(const Item& it, int position, const QDate& today) const {
+    return forecast(it, position, today, meanLoanDays());
+}
+
+// Not queued: when they would get it if they joined the queue now.
+QDate AvailabilityForecast::expected(int userId, int itemId, const QDate& today) const {
+    const CatalogueSnapshot snap = cat_->snapshot();
+    const Item* it = snap.findItem(itemId);
+    if (!it) return QDate();
+    return forecast(*it, it->holdQueue.indexOf(userId) + 1, today, meanLoanDays());
+}
+
+QVector<HoldForecast> AvailabilityForecast::forUser(int userId, const QDate& today) const {
+    QVector<HoldForecast> out;
+    const CatalogueSnapshot snap = cat_->snapshot();
+    const User* u = snap.findUserById(userId);
+    if (!u) return out;
+    const double mean = meanLoanDays();
+    out.reserve(u->holds.size());
+    for (int itemId : u->holds) {
+        HoldForecast f;
+        f.itemId = itemId;
+        if (const Item* it = snap.findItem(itemId)) {
+            const int idx = it->holdQueue.indexOf(userId);
+            if (idx >= 0) {
+                f.position = idx + 1;
+                f.expected = forecast(*it, f.position, today, mean);
+            }
+        }
+        out.append(f);
+    }
+    return out;
+}
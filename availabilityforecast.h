@@ -0,0 +1,62 @@
+#ifndef AVAILABILITYFORECAST_H
+#define AVAILABILITYFORECAST_H
+
+#include <QDate>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+#include "changeset.h"
+
+class Catalogue;
+class LibraryController;
+struct Item;
+
+// One of a user's holds with its expected pickup date.
+struct HoldForecast {
+    int itemId = -1;
+    int position = -1;    // 1-based place in the queue
+    QDate expected;       // invalid if the item or hold is gone
+};
+
+// "When will I get this?" An item frees up when its loan is expected to end,
+// not before today and not after its due date; each holder ahead then keeps
+// it for an average loan. The average starts at the standard loan period and
+// follows the loans seen to end, so habitual early returns pull forecasts in.
+//
+// A forecast is O(log n) in the queue length: the position comes from
+// HoldQueue's index and the rest from the item's due date. The only state,
+// the average and the loans it is waiting on, is updated from each change
+// notice, never by walking queues. Items are read from Catalogue::snapshot(),
+// so every call is safe alongside a concurrent controller.
+class AvailabilityForecast {
+public:
+    explicit AvailabilityForecast(const Catalogue* cat);
+
+    // Feeds the controller's change notices into observe().
+    void attach(LibraryController* lib);
+    void observe(const ChangeSet& changes, const QDate& today);
+
+    double meanLoanDays() const;
+    // Bumped whenever the average moves, which shifts every forecast; cached
+    // ones from an older generation are out of date.
+    quint64 generation() const;
+
+    // For a holder at `position` (1-based), or for someone joining the end
+    // of the queue if position <= 0.
+    QDate expected(const Item& it, int position, const QDate& today) const;
+    QDate expected(int userId, int itemId, const QDate& today) const;
+
+    // Every hold of the user, in the order of User::holds.
+    QVector<HoldForecast> forUser(int userId, const QDate& today) const;
+
+private:
+    Q_DISABLE_COPY(AvailabilityForecast)
+
+    const Catalogue* cat_;
+    mutable QMutex lock_;
+    double meanLoanDays_;
+    quint64 generation_ = 0;
+    QHash<int, QDate> onLoan_;    // item id -> loan start, for loans seen to start
+};
+
+#endif // AVAILABILITYFORECAST_H
@@ -0,0 +1,61 @@
+#include "allocs.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+static std::atomic<quint64> gAllocs(0);
+
+quint64 allocationCount() { return gAllocs.load(std::memory_order_relaxed); }
+
+quint64 residentKb() {
+#if defined(Q_OS_LINUX)
+    unsigned long long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    const int n = fscanf(f, "%llu %llu", &pages, &resident);
+    fclose(f);
+    return n == 2 ? resident * quint64(sysconf(_SC_PAGESIZE)) / 1024 : 0;
+#else
+    return 0;
+#endif
+}
+
+#if defined(__GLIBC__)
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+
+void* malloc(size_t n) {
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(n);
+}
+void* calloc(size_t n, size_t size) {
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+void* realloc(void* p, size_t n) {
+    if (!p) gAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, n);
+}
+}
+
+#else
+
+void* operator new(std::size_t n) {
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
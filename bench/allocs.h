@@ -0,0 +1,14 @@
+#ifndef ALLOCS_H
+#define ALLOCS_H
+
+#include <QtGlobal>
+
+// Process-wide count of heap allocations (bench binary only). On glibc the
+// malloc family is wrapped, which also catches Qt's container/QString
+// allocations; elsewhere only operator new is counted.
+quint64 allocationCount();
+
+// Resident set size in KiB, or 0 where the platform doesn't say.
+quint64 residentKb();
+
+#endif // ALLOCS_H
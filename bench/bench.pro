@@ -0,0 +1,19 @@
+# Benchmarks over generated catalogues: qmake bench/bench.pro && make
+# Run ./hinlibs-bench --help for scenarios; output is JSON lines.
+
+QT       = core
+CONFIG  += console c++11
+CONFIG  -= app_bundle
+TARGET   = hinlibs-bench
+
+include(../core.pri)
+
+SOURCES += \
+    allocs.cpp \
+    cataloguegen.cpp \
+    main.cpp
+
+HEADERS += \
+    allocs.h \
+    cataloguegen.h \
+    rng.h
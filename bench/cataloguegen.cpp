@@ -0,0 +1,95 @@
+#include "cataloguegen.h"
+#include "rng.h"
+#include "catalogue.h"
+#include <QStringList>
+
+static const char* const kWords[] = {
+    "silent","forest","echoes","dawn","paper","moon","winter","edge","ember","rain",
+    "history","numbers","ocean","currents","mind","learning","light","shadow","city","river",
+    "stone","garden","empire","signal","harbor","glass","iron","north","summer","voyage",
+    "secret","meadow","atlas","machine","kingdom","letters","storm","island","memory","fire",
+    "quiet","rooms","midnight","sketch","horizon","solar","drift","circuit","siege","neon",
+    "courier","verdant","realm","archive","market","theory","practice","guide","field","song"
+};
+static const char* const kSurnames[] = {
+    "Greenwood","Rivera","Chen","Patel","Alvarez","Kumar","Suzuki","Dweck","Nguyen","Rossi",
+    "Park","Okafor","Haddad","Smith","Garcia","Fischer","Kowalski","Tanaka","Silva","Dubois",
+    "Ivanova","Moreau","Larsen","O'Brien","Mendes","Novak","Hughes","Bauer","Costa","Yilmaz"
+};
+static const char* const kGenres[]  = { "Adventure","Thriller","Drama","Comedy","Sci-Fi","Documentary",
+                                        "Racing","RPG","Strategy","Action","Puzzle","Sports" };
+static const char* const kMovieRatings[] = { "G","PG","PG-13","R" };
+static const char* const kGameRatings[]  = { "E","E10+","T","M" };
+static const char* const kFirstNames[]   = { "Alice","Bob","Carmen","Diego","Eva","Liam","Sara","Noah",
+                                             "Mia","Omar","Priya","Quinn","Ravi","Tess","Uma","Victor" };
+
+template <typename T, int N> static int countOf(T (&)[N]) { return N; }
+
+static QString title(Rng& rng) {
+    const int words = 1 + rng.below(4) + rng.below(2);
+    QString t;
+    for (int w = 0; w < words; ++w) {
+        QString word = kWords[rng.below(countOf(kWords))];
+        word[0] = word.at(0).toUpper();
+        if (w) t += ' ';
+        t += word;
+    }
+    return t;
+}
+
+void generateCatalogue(Catalogue& cat, const CatalogueSpec& spec) {
+    cat.items.clear();
+    cat.users.clear();
+    cat.reindex();
+
+    Rng rng(spec.seed);
+
+    // Creators: ~1 per 40 items, picked with a Zipf skew so a few publishers
+    // and prolific authors own much of the collection.
+    QStringList creators;
+    const int nCreators = qMax(16, spec.items / 40);
+    for (int i = 0; i < nCreators; ++i)
+        creators << QString("%1. %2").arg(QChar('A' + rng.below(26))).arg(kSurnames[rng.below(countOf(kSurnames))]);
+    ZipfSampler creatorPick(nCreators, 0.9);
+
+    // addItem() interns the text as it goes, so duplicates never pile up.
+    cat.items.reserve(spec.items);
+    for (int i = 0; i < spec.items; ++i) {
+        Item it;
+        it.id = 100 + i;
+        it.title = title(rng);
+        it.creator = creators.at(creatorPick.sample(rng));
+
+        const int roll = rng.below(100);          // 45 / 30 / 8 / 10 / 7 %
+        if (roll < 45) {
+            it.type = ItemType::Fiction;
+        } else if (roll < 75) {
+            it.type = ItemType::NonFiction;
+            it.dewey = QString("%1.%2").arg(rng.below(1000), 3, 10, QChar('0')).arg(rng.below(100));
+        } else if (roll < 83) {
+            it.type = ItemType::Magazine;
+            it.issue = QString("Vol. %1, No. %2").arg(1 + rng.below(60)).arg(1 + rng.below(12));
+            it.pub = QDate(2000, 1, 1).addDays(rng.below(9500));
+        } else if (roll < 93) {
+            it.type = ItemType::Movie;
+            it.genre = kGenres[rng.below(6)];
+            it.rating = kMovieRatings[rng.below(countOf(kMovieRatings))];
+        } else {
+            it.type = ItemType::VideoGame;
+            it.genre = kGenres[6 + rng.below(6)];
+            it.rating = kGameRatings[rng.below(countOf(kGameRatings))];
+        }
+        cat.addItem(it);
+    }
+
+    cat.users.reserve(spec.users);
+    for (int i = 0; i < spec.users; ++i) {
+        User u;
+        u.id = 1 + i;
+        u.name = QString("%1 %2 %3").arg(kFirstNames[rng.below(countOf(kFirstNames))])
+                                    .arg(kSurnames[rng.below(countOf(kSurnames))]).arg(u.id);
+        const int roll = rng.below(1000);
+        u.type = roll < 990 ? UserType::Patron : roll < 998 ? UserType::Librarian : UserType::Admin;
+        cat.addUser(u);
+    }
+}
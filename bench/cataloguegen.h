@@ -0,0 +1,19 @@
+#ifndef CATALOGUEGEN_H
+#define CATALOGUEGEN_H
+
+#include <QtGlobal>
+
+class Catalogue;
+
+// Deterministic synthetic catalogue: a realistic ItemType mix (mostly
+// books), short multi-word titles, a creator pool that is reused heavily,
+// and the small genre/rating vocabularies real collections have.
+struct CatalogueSpec {
+    int items = 100000;
+    int users = 10000;
+    quint64 seed = 42;
+};
+
+void generateCatalogue(Catalogue& cat, const CatalogueSpec& spec);
+
+#endif // CATALOGUEGEN_H
@@ -0,0 +1,983 @@
+// hinlibs-bench: circulation benchmarks over generated catalogues.
+// Every scenario prints one JSON object per line on stdout.
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QStringList>
+#include <QDir>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <cstdio>
+#include <thread>
+#include "catalogue.h"
+#include "librarycontroller.h"
+#include "holdqueue.h"
+#include "cataloguecsv.h"
+#include "cataloguestore.h"
+#include "searchindex.h"
+#include "journal.h"
+#include "itempolicy.h"
+#include "cataloguesnapshot.h"
+#include "reportengine.h"
+#include "cataloguegen.h"
+#include "rng.h"
+#include "allocs.h"
+
+namespace {
+
+struct Options {
+    int items = 100000;
+    int users = 10000;
+    int ops = 1000000;
+    quint64 seed = 42;
+    double zipf = 1.0;
+    QList<int> mix;   // borrow, return, hold, cancel, query weights
+    bool intern = true;
+};
+
+void emitJson(const QJsonObject& o) {
+    printf("%s\n", QJsonDocument(o).toJson(QJsonDocument::Compact).constData());
+    fflush(stdout);
+}
+
+// Latency samples for one kind of operation.
+class Samples {
+public:
+    void add(qint64 ns, bool ok) { ns_.append(ns); ok_ += ok ? 1 : 0; }
+    QJsonObject summary() {
+        std::sort(ns_.begin(), ns_.end());
+        QJsonObject o;
+        o["count"] = ns_.size();
+        o["ok"] = ok_;
+        o["p50_ns"]  = double(at(0.50));
+        o["p99_ns"]  = double(at(0.99));
+        o["p999_ns"] = double(at(0.999));
+        return o;
+    }
+    void merge(const Samples& other) { ns_ += other.ns_; ok_ += other.ok_; }
+
+private:
+    qint64 at(double p) const {
+        if (ns_.isEmpty()) return 0;
+        return ns_.at(qMin(int(ns_.size()) - 1, int(p * ns_.size())));
+    }
+    QVector<qint64> ns_;
+    int ok_ = 0;
+};
+
+void makeCatalogue(Catalogue& cat, int items, int users, quint64 seed) {
+    CatalogueSpec spec;
+    spec.items = items;
+    spec.users = users;
+    spec.seed = seed;
+    generateCatalogue(cat, spec);
+}
+
+// ---------------------- circulation ----------------------
+// Zipf-popular items, uniformly chosen patrons, a configurable op mix.
+void runCirculation(const Options& o) {
+    Catalogue cat;
+    makeCatalogue(cat, o.items, o.users, o.seed);
+    LibraryController lib(&cat);
+
+    Rng rng(o.seed ^ 0xC1C);
+    QVector<int> byRank;   // popularity rank -> item id, shuffled so rank != id order
+    byRank.reserve(cat.items.size());
+    for (const auto& it : cat.items) byRank.append(it.id);
+    for (int i = byRank.size() - 1; i > 0; --i) std::swap(byRank[i], byRank[rng.below(i + 1)]);
+    const ZipfSampler popular(byRank.size(), o.zipf);
+
+    static const char* const kKinds[] = { "borrow", "return", "hold", "cancel", "query" };
+    int total = 0;
+    for (int w : o.mix) total += w;
+    Samples kinds[5];
+
+    QElapsedTimer clock;
+    const quint64 allocs0 = allocationCount();
+    clock.start();
+    for (int n = 0; n < o.ops; ++n) {
+        int roll = rng.below(total), kind = 0;
+        while (roll >= o.mix.at(kind)) roll -= o.mix.at(kind++);
+
+        const User& u = cat.users.at(rng.below(cat.users.size()));
+        int item = byRank.at(popular.sample(rng));
+        if (kind == 1 && !u.loans.isEmpty()) item = u.loans.at(rng.below(u.loans.size()));
+        if (kind == 3 && !u.holds.isEmpty()) item = u.holds.at(rng.below(u.holds.size()));
+
+        const qint64 t0 = clock.nsecsElapsed();
+        bool ok = false;
+        switch (kind) {
+            case 0: ok = lib.borrow(u.id, item).ok; break;
+            case 1: ok = lib.returnItem(u.id, item).ok; break;
+            case 2: ok = lib.placeHold(u.id, item).ok; break;
+            case 3: ok = lib.cancelHold(u.id, item).ok; break;
+            case 4: ok = lib.canBorrow(u.id, item).ok; break;
+        }
+        kinds[kind].add(clock.nsecsElapsed() - t0, ok);
+    }
+    const double secs = clock.nsecsElapsed() / 1e9;
+    const quint64 allocs = allocationCount() - allocs0;
+
+    QJsonObject byKind;
+    Samples all;
+    for (int k = 0; k < 5; ++k) {
+        all.merge(kinds[k]);
+        byKind[kKinds[k]] = kinds[k].summary();
+    }
+    QJsonObject out = all.summary();
+    out["scenario"] = "circulation";
+    out["items"] = o.items;
+    out["users"] = o.users;
+    out["zipf"] = o.zipf;
+    out["seconds"] = secs;
+    out["ops_per_sec"] = o.ops / secs;
+    out["allocs_per_op"] = double(allocs) / o.ops;
+    out["by_kind"] = byKind;
+    emitJson(out);
+}
+
+// ---------------------- memory ----------------------
+// Resident memory of a generated catalogue; run once with and once without
+// --no-intern to see what text interning saves.
+void runMemory(const Options& o) {
+    const quint64 before = residentKb();
+    Catalogue cat;
+    cat.setInterning(o.intern);
+    makeCatalogue(cat, o.items, o.users, o.seed);
+    const quint64 after = residentKb();
+
+    QJsonObject out;
+    out["scenario"] = "memory";
+    out["items"] = o.items;
+    out["users"] = o.users;
+    out["interning"] = o.intern;
+    out["distinct_text"] = cat.distinctText();
+    out["rss_kb_before"] = double(before);
+    out["rss_kb_after"] = double(after);
+    out["rss_kb_catalogue"] = double(after - before);
+    emitJson(out);
+}
+
+// ---------------------- csv ----------------------
+// Export the generated catalogue, then import it into an empty one with one
+// parser thread and with one per core.
+void runCsv(const Options& o) {
+    Catalogue cat;
+    makeCatalogue(cat, o.items, 16, o.seed);
+    const QString path = QDir::temp().filePath("hinlibs-bench.csv");
+
+    QElapsedTimer clock;
+    clock.start();
+    QString error;
+    if (!CatalogueCsv::exportFile(cat, path, &error)) {
+        fprintf(stderr, "bench: %s\n", qPrintable(error));
+        return;
+    }
+    const double exportSecs = clock.nsecsElapsed() / 1e9;
+
+    for (int threads : {1, 0}) {
+        Catalogue loaded;
+        ImportOptions options;
+        options.threads = threads;
+        ImportReport rep;
+        clock.restart();
+        CatalogueCsv::importFile(loaded, path, &rep, &error, options);
+        const double secs = clock.nsecsElapsed() / 1e9;
+
+        QJsonObject out;
+        out["scenario"] = "csv";
+        out["items"] = o.items;
+        out["threads"] = threads ? threads : QThread::idealThreadCount();
+        out["export_records_per_sec"] = o.items / exportSecs;
+        out["import_records_per_sec"] = rep.imported / secs;
+        out["rejected"] = rep.rejected;
+        emitJson(out);
+    }
+    QFile::remove(path);
+}
+
+// ---------------------- store ----------------------
+// Snapshot save and load of the generated catalogue (target: a 1M-item
+// load in under 200 ms; run with --items 1000000). Load includes rebuilding
+// every index, as at startup.
+void runStore(const Options& o) {
+    Catalogue cat;
+    makeCatalogue(cat, o.items, o.users, o.seed);
+    const QString path = QDir::temp().filePath("hinlibs-bench.snap");
+
+    QElapsedTimer clock;
+    clock.start();
+    QString error;
+    if (!CatalogueStore::saveSnapshot(cat, path, 0, &error)) {
+        fprintf(stderr, "bench: %s\n", qPrintable(error));
+        return;
+    }
+    const double saveMs = clock.nsecsElapsed() / 1e6;
+
+    Catalogue loaded;
+    quint64 seq = 0;
+    clock.restart();
+    const bool ok = CatalogueStore::loadSnapshot(loaded, path, &seq, &error);
+    const double loadMs = clock.nsecsElapsed() / 1e6;
+
+    QJsonObject out;
+    out["scenario"] = "store";
+    out["items"] = o.items;
+    out["users"] = o.users;
+    out["bytes"] = double(QFile(path).size());
+    out["save_ms"] = saveMs;
+    out["load_ms"] = loadMs;
+    out["ok"] = ok && loaded.items.size() == cat.items.size() && loaded.users.size() == cat.users.size();
+    emitJson(out);
+    QFile::remove(path);
+}
+
+// ---------------------- lookup ----------------------
+// Catalogue::findItem (hash) against the linear scan it replaced.
+void runLookup(const Options& o, const QList<int>& sizes) {
+    for (int n : sizes) {
+        Catalogue cat;
+        makeCatalogue(cat, n, 16, o.seed);
+        Rng rng(o.seed);
+        QElapsedTimer clock;
+        quint64 sink = 0;
+
+        const int hashed = o.ops;
+        clock.start();
+        for (int i = 0; i < hashed; ++i) sink += quintptr(cat.findItem(100 + rng.below(n)));
+        const double hashNs = double(clock.nsecsElapsed()) / hashed;
+
+        const int linear = qMax(10, int(qMin<qint64>(o.ops, 200000000LL / n)));
+        clock.restart();
+        for (int i = 0; i < linear; ++i) {
+            const int id = 100 + rng.below(n);
+            for (const auto& it : cat.items) if (it.id == id) { sink += quintptr(&it); break; }
+        }
+        const double scanNs = double(clock.nsecsElapsed()) / linear;
+
+        QJsonObject out;
+        out["scenario"] = "lookup";
+        out["items"] = n;
+        out["hash_ns"] = hashNs;
+        out["linear_ns"] = scanNs;
+        out["speedup"] = scanNs / hashNs;
+        out["sink"] = double(sink & 1);
+        emitJson(out);
+    }
+}
+
+// ---------------------- scan ----------------------
+// "All available items of type X": Item records against ItemColumns.
+void runScan(const Options& o) {
+    Catalogue cat;
+    makeCatalogue(cat, o.items, 16, o.seed);
+    const int rounds = qMax(1, int(qMin<qint64>(1000, 200000000LL / qMax(1, o.items))));
+
+    for (bool columnar : {false, true}) {
+        cat.setColumnar(columnar);
+        QElapsedTimer clock;
+        qint64 hits = 0;
+        clock.start();
+        for (int r = 0; r < rounds; ++r) hits += cat.availableOfType(ItemType(r % 5)).size();
+        const double secs = clock.nsecsElapsed() / 1e9;
+
+        QJsonObject out;
+        out["scenario"] = "scan";
+        out["layout"] = columnar ? "columnar" : "records";
+        out["items"] = o.items;
+        out["rounds"] = rounds;
+        out["items_per_sec"] = double(rounds) * o.items / secs;
+        out["hits"] = double(hits);
+        emitJson(out);
+    }
+}
+
+// ---------------------- facets ----------------------
+// "Available RPG video games rated T" and per-genre counts, through the
+// facet bitmaps against a scan of the items; run with --items 1000000.
+void runFacets(const Options& o) {
+    Catalogue cat;
+    makeCatalogue(cat, o.items, 16, o.seed);
+
+    // Check out about a third of the collection through touchCirculation(), the
+    // same path circulation takes.
+    Rng rng(o.seed ^ 0xFACE);
+    QElapsedTimer clock;
+    clock.start();
+    int touched = 0;
+    for (auto& it : cat.items) {
+        if (rng.below(3)) continue;
+        it.status = Availability::CheckedOut;
+        cat.touchCirculation(it.id);
+        ++touched;
+    }
+    const double updateNs = double(clock.nsecsElapsed()) / qMax(1, touched);
+
+    FacetQuery q;
+    q.types << ItemType::VideoGame;
+    q.statuses << Availability::Available;
+    q.genres << "RPG";
+    q.ratings << "T";
+    const int rounds = qMax(1, int(qMin<qint64>(1000, 100000000LL / qMax(1, o.items))));
+    qint64 hits = 0;
+
+    clock.restart();
+    for (int r = 0; r < rounds; ++r) hits += cat.browse(q).size();
+    const double browseNs = double(clock.nsecsElapsed()) / rounds;
+
+    clock.restart();
+    for (int r = 0; r < rounds; ++r) hits += cat.browseCount(q);
+    const double countNs = double(clock.nsecsElapsed()) / rounds;
+
+    FacetQuery available;
+    available.statuses << Availability::Available;
+    clock.restart();
+    for (int r = 0; r < rounds; ++r) hits += cat.facetCounts(Facet::Genre, available).size();
+    const double genreCountsNs = double(clock.nsecsElapsed()) / rounds;
+
+    clock.restart();
+    for (int r = 0; r < rounds; ++r) {
+        QVector<int> ids;
+        for (const auto& it : cat.items)
+            if (it.type == ItemType::VideoGame && it.status == Availability::Available
+                    && it.genre.compare("RPG", Qt::CaseInsensitive) == 0
+                    && it.rating.compare("T", Qt::CaseInsensitive) == 0)
+                ids.append(it.id);
+        hits += ids.size();
+    }
+    const double scanNs = double(clock.nsecsElapsed()) / rounds;
+
+    QJsonObject out;
+    out["scenario"] = "facets";
+    out["items"] = o.items;
+    out["rounds"] = rounds;
+    out["matches"] = cat.browseCount(q);
+    out["browse_ns"] = browseNs;
+    out["count_ns"] = countNs;
+    out["genre_counts_ns"] = genreCountsNs;
+    out["scan_ns"] = scanNs;
+    out["speedup"] = scanNs / browseNs;
+    out["update_ns"] = updateNs;
+    out["sink"] = double(hits & 1);
+    emitJson(out);
+}
+
+// ---------------------- batch ----------------------
+// Returning k loans one call at a time against one returnBatch().
+void runBatch(const Options& o, const QList<int>& sizes) {
+    for (int k : sizes) {
+        double perOp[2] = {0, 0};
+        for (int batched = 0; batched < 2; ++batched) {
+            Catalogue cat;
+            makeCatalogue(cat, qMax(o.items, k), qMax(o.users, k / 3 + 1), o.seed);
+            LibraryController lib(&cat);
+            QVector<CirculationOp> ops;
+            ops.reserve(k);
+            for (int i = 0; i < k; ++i) ops.append(CirculationOp(1 + i / 3, 100 + i));
+            lib.borrowBatch(ops);
+
+            QElapsedTimer clock;
+            clock.start();
+            if (batched) lib.returnBatch(ops);
+            else for (const auto& op : ops) lib.returnItem(op.userId, op.itemId);
+            perOp[batched] = double(clock.nsecsElapsed()) / k;
+        }
+        QJsonObject out;
+        out["scenario"] = "batch";
+        out["ops"] = k;
+        out["single_ns_per_op"] = perOp[0];
+        out["batch_ns_per_op"] = perOp[1];
+        emitJson(out);
+    }
+}
+
+// ---------------------- snapshot ----------------------
+// One thread circulates flat out (aim: 100k+ writes/sec) while readers scan
+// snapshots and check that each one is whole: every checked-out item is on
+// its borrower's loan list and hold queues match users' hold lists. Any
+// mismatch is a torn read; "torn" must be 0, or the bench exits non-zero.
+bool runSnapshot(const Options& o, int readers) {
+    Catalogue cat;
+    makeCatalogue(cat, o.items, o.users, o.seed);
+    LibraryController lib(&cat, 64);
+
+    std::atomic<bool> done(false);
+    std::atomic<qint64> scans(0), torn(0), takeNs(0);
+    auto reader = [&]{
+        QElapsedTimer clock;
+        clock.start();
+        while (!done.load()) {
+            const qint64 t0 = clock.nsecsElapsed();
+            const CatalogueSnapshot snap = cat.snapshot();
+            takeNs += clock.nsecsElapsed() - t0;
+
+            qint64 out = 0, loans = 0, queued = 0, holds = 0, bad = 0;
+            for (int i = 0; i < snap.itemCount(); ++i) {
+                const Item& it = snap.itemAt(i);
+                queued += it.holdQueue.size();
+                if (it.status != Availability::CheckedOut) continue;
+                ++out;
+                const User* u = snap.findUserById(it.borrowerId);
+                if (!u || !u->hasLoan(it.id)) ++bad;
+            }
+            for (int i = 0; i < snap.userCount(); ++i) {
+                loans += snap.userAt(i).loans.size();
+                holds += snap.userAt(i).holds.size();
+            }
+            torn += bad + (out != loans) + (queued != holds);
+            ++scans;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int r = 0; r < readers; ++r) pool.emplace_back(reader);
+
+    Rng rng(o.seed ^ 0x5A9);
+    QElapsedTimer clock;
+    clock.start();
+    for (int n = 0; n < o.ops; ++n) {
+        const User& u = cat.users.at(rng.below(cat.users.size()));
+        const int item = cat.items.at(rng.below(cat.items.size())).id;
+        switch (rng.below(4)) {
+            case 0: lib.borrow(u.id, item); break;
+            case 1: lib.returnItem(u.id, u.loans.isEmpty() ? item : u.loans.first()); break;
+            case 2: lib.placeHold(u.id, item); break;
+            case 3: lib.cancelHold(u.id, u.holds.isEmpty() ? item : u.holds.first()); break;
+        }
+    }
+    const double secs = clock.nsecsElapsed() / 1e9;
+    done = true;
+    for (auto& t : pool) t.join();
+
+    QJsonObject out;
+    out["scenario"] = "snapshot";
+    out["items"] = o.items;
+    out["readers"] = readers;
+    out["writes_per_sec"] = o.ops / secs;
+    out["scans_per_sec"] = double(scans.load()) / secs;
+    out["snapshot_ns"] = double(takeNs.load()) / qMax<qint64>(1, scans.load());
+    out["torn"] = double(torn.load());
+    emitJson(out);
+    return torn.load() == 0;
+}
+
+// ---------------------- invariants ----------------------
+// One controller shared by threads hammering a small hot set of items, so
+// commands on the same user or item race constantly. Afterwards the final
+// state must hold the rules (at most 3 loans, one borrower per item, hold
+// queues and hold lists agree), and the journal, replayed in order on one
+// thread from the same start, must accept every record and end in the same
+// state: the concurrent history was one valid sequential history, so no
+// borrow jumped a hold queue. "violations" must be 0.
+bool runInvariants(const Options& o) {
+    const int items = qMin(o.items, 64), users = qMin(o.users, 32);
+    const int threads = qMax(4, QThread::idealThreadCount());
+    Catalogue cat;
+    makeCatalogue(cat, items, users, o.seed);
+    const QString path = QDir::temp().filePath("hinlibs-bench.journal");
+    QFile::remove(path);
+    Journal journal;
+    if (!journal.open(path)) {
+        fprintf(stderr, "bench: cannot open %s\n", qPrintable(path));
+        return false;
+    }
+    journal.startFlusher(5);
+    LibraryController lib(&cat, 64);
+    lib.setJournal(&journal);
+
+    QVector<int> itemIds, userIds;
+    for (const auto& it : cat.items) itemIds.append(it.id);
+    for (const auto& u : cat.users) userIds.append(u.id);
+
+    std::atomic<qint64> done(0);
+    auto worker = [&](int t) {
+        Rng rng(o.seed ^ (0x1A7 + t));
+        CatalogueSnapshot snap;
+        for (int n = 0; n < o.ops / threads; ++n) {
+            // Aim returns and cancels at a recent borrower or holder.
+            if (n % 256 == 0) snap = cat.snapshot();
+            const int item = itemIds.at(rng.below(itemIds.size()));
+            int user = userIds.at(rng.below(userIds.size()));
+            const Item* seen = snap.findItem(item);
+            switch (rng.below(10)) {
+                case 0: case 1: case 2: lib.borrow(user, item); break;
+                case 3: case 4: case 5:
+                    if (seen && seen->borrowerId >= 0) user = seen->borrowerId;
+                    lib.returnItem(user, item);
+                    break;
+                case 6: case 7: lib.placeHold(user, item); break;
+                default:
+                    if (seen && !seen->holdQueue.isEmpty())
+                        user = seen->holdQueue.toList().at(rng.below(seen->holdQueue.size()));
+                    lib.cancelHold(user, item);
+                    break;
+            }
+            ++done;
+        }
+    };
+    QElapsedTimer clock;
+    clock.start();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+    for (auto& t : pool) t.join();
+    const double secs = clock.nsecsElapsed() / 1e9;
+    journal.close();
+
+    int violations = 0;
+    auto fail = [&](const QString& what) {
+        if (++violations <= 10) fprintf(stderr, "bench: invariants: %s\n", qPrintable(what));
+    };
+
+    // Final state against the rules.
+    int loans = 0, holds = 0, out = 0, queued = 0;
+    for (const auto& u : cat.users) {
+        if (u.loans.size() > 3) fail(QString("user %1 has %2 loans").arg(u.id).arg(u.loans.size()));
+        loans += u.loans.size();
+        holds += u.holds.size();
+    }
+    for (const auto& it : cat.items) {
+        queued += it.holdQueue.size();
+        QVector<int> seen;
+        for (int holder : it.holdQueue.toList()) {
+            const User* u = cat.findUserById(holder);
+            if (seen.contains(holder)) fail(QString("user %1 queued twice for item %2").arg(holder).arg(it.id));
+            if (!u || !u->holds.contains(it.id)) fail(QString("item %1 queues user %2 who has no hold").arg(it.id).arg(holder));
+            seen.append(holder);
+        }
+        int borrowers = 0;
+        for (const auto& u : cat.users) borrowers += u.loans.contains(it.id) ? 1 : 0;
+        const bool lent = it.status == Availability::CheckedOut;
+        out += lent ? 1 : 0;
+        if (borrowers != (lent ? 1 : 0)) fail(QString("item %1 is on %2 loan lists").arg(it.id).arg(borrowers));
+        const User* b = lent ? cat.findUserById(it.borrowerId) : nullptr;
+        if (lent && (!b || !b->loans.contains(it.id))) fail(QString("item %1 borrower mismatch").arg(it.id));
+    }
+    if (loans != out) fail(QString("%1 loans for %2 checked-out items").arg(loans).arg(out));
+    if (holds != queued) fail(QString("%1 holds for %2 queue entries").arg(holds).arg(queued));
+
+    // The journal replayed sequentially: every record valid, same end state.
+    QList<Journal::Record> records;
+    Journal reread;
+    if (!reread.open(path, &records)) fail("journal unreadable");
+    reread.close();
+    QFile::remove(path);
+    Catalogue replay;
+    makeCatalogue(replay, items, users, o.seed);
+    LibraryController serial(&replay);
+    for (const auto& r : records) {
+        Result res;
+        switch (r.op) {
+            case Journal::Borrow:     res = serial.borrow(r.userId, r.itemId); break;
+            case Journal::Return:     res = serial.returnItem(r.userId, r.itemId); break;
+            case Journal::PlaceHold:  res = serial.placeHold(r.userId, r.itemId); break;
+            case Journal::CancelHold: res = serial.cancelHold(r.userId, r.itemId); break;
+        }
+        if (!res.ok) fail(QString("record %1 rejected on replay: %2").arg(r.seq).arg(res.message));
+    }
+    auto sorted = [](QList<int> l) { std::sort(l.begin(), l.end()); return l; };
+    for (const auto& it : cat.items) {
+        const Item* r = replay.findItem(it.id);
+        if (!r || r->status != it.status || r->borrowerId != it.borrowerId || r->holdQueue != it.holdQueue)
+            fail(QString("item %1 differs after replay").arg(it.id));
+    }
+    for (const auto& u : cat.users) {
+        const User* r = replay.findUserById(u.id);
+        if (!r || sorted(r->loans) != sorted(u.loans) || sorted(r->holds) != sorted(u.holds))
+            fail(QString("user %1 differs after replay").arg(u.id));
+    }
+
+    QJsonObject res;
+    res["scenario"] = "invariants";
+    res["items"] = items;
+    res["users"] = users;
+    res["threads"] = threads;
+    res["ops_per_sec"] = double(done.load()) / secs;
+    res["journaled"] = records.size();
+    res["violations"] = violations;
+    emitJson(res);
+    return violations == 0;
+}
+
+// ---------------------- reports ----------------------
+// The admin reports at 1, 2, 4 ... threads up to one per core, over a
+// synthetic report table (no Catalogue, so 10M rows fit in memory); run with
+// --items 10000000. speedup is against the 1-thread run of the same report.
+void runReports(const Options& o) {
+    Rng rng(o.seed ^ 0x4E9);
+    const QDate today = QDate::currentDate();
+    ReportTable table;
+    table.reserve(o.items);
+    for (int i = 0; i < o.items; ++i) {
+        Item it;
+        it.id = 100 + i;
+        it.type = ItemType(rng.below(kItemTypeCount));
+        if (rng.below(3) == 0) {
+            it.status = Availability::CheckedOut;
+            it.borrowerId = 1 + rng.below(o.users);
+            it.due = today.addDays(rng.below(30) - 10);
+        }
+        table.append(it);
+        if (rng.below(20) == 0) table.holds.last() = 1 + rng.below(8);
+    }
+
+    const struct { const char* name; ReportQuery query; } reports[] = {
+        { "loans_per_type", ReportQuery::loansPerType() },
+        { "longest_hold_queues", ReportQuery::longestHoldQueues(10) },
+        { "overdue_by_patron", ReportQuery::overdueByPatron(today, 10) },
+    };
+    const int cores = QThread::idealThreadCount();
+    QList<int> counts;
+    for (int t = 1; t < cores; t *= 2) counts << t;
+    counts << cores;
+
+    for (const auto& r : reports) {
+        double base = 0;
+        for (int threads : counts) {
+            const ReportEngine engine(threads);
+            QElapsedTimer clock;
+            double best = 1e99;
+            qint64 sink = 0;
+            for (int rep = 0; rep < 3; ++rep) {
+                clock.start();
+                sink += engine.run(table, r.query).size();
+                best = qMin(best, clock.nsecsElapsed() / 1e9);
+            }
+            if (threads == 1) base = best;
+
+            QJsonObject out;
+            out["scenario"] = "reports";
+            out["report"] = r.name;
+            out["items"] = o.items;
+            out["threads"] = threads;
+            out["rows_per_sec"] = o.items / best;
+            out["speedup"] = base / best;
+            out["groups"] = double(sink / 3);
+            emitJson(out);
+        }
+    }
+}
+
+// ---------------------- relations ----------------------
+// The loan/hold relation index at o.users patrons (try --users 1000000):
+// bytes per edge and per user, link/unlink cost, and "who holds anything by
+// this creator" answered from the index against a scan of every user's holds.
+void runRelations(const Options& o) {
+    Catalogue cat;
+    makeCatalogue(cat, o.items, o.users, o.seed);
+    const qint64 emptyBytes = cat.relationBytes();
+    Rng rng(o.seed ^ 0x5E1);
+
+    // Up to 3 loans and a few holds each, like a busy system.
+    QElapsedTimer clock;
+    clock.start();
+    int edges = 0;
+    for (const User& u : cat.users) {
+        for (int k = rng.below(4); k > 0; --k) edges += cat.link(Relation::Loan, u.id, 100 + rng.below(o.items));
+        for (int k = rng.below(6); k > 0; --k) edges += cat.link(Relation::Hold, u.id, 100 + rng.below(o.items));
+    }
+    const double linkNs = double(clock.nsecsElapsed()) / qMax(1, edges);
+    const qint64 bytes = cat.relationBytes();
+
+    // Traversal both ways.
+    qint64 sink = 0;
+    const int probes = qMin(o.ops, 1000000);
+    clock.restart();
+    for (int i = 0; i < probes; ++i) sink += cat.itemsOf(Relation::Hold, 1 + rng.below(o.users)).size();
+    const double byUserNs = double(clock.nsecsElapsed()) / probes;
+    clock.restart();
+    for (int i = 0; i < probes; ++i) sink += cat.usersOf(Relation::Hold, 100 + rng.below(o.items)).size();
+    const double byItemNs = double(clock.nsecsElapsed()) / probes;
+
+    // Holders of anything by the first item's creator (likely a prolific one).
+    const QString creator = cat.items.first().creator;
+    QVector<int> byCreator;
+    for (const Item& it : cat.items) if (it.creator == creator) byCreator.append(it.id);
+    clock.restart();
+    const QVector<int> viaIndex = cat.usersOfAny(Relation::Hold, byCreator);
+    const double indexUs = clock.nsecsElapsed() / 1e3;
+    clock.restart();
+    QVector<int> viaScan;
+    for (const User& u : cat.users) {
+        for (int itemId : u.holds) {
+            const Item* it = cat.findItem(itemId);
+            if (it && it->creator == creator) { viaScan.append(u.id); break; }
+        }
+    }
+    const double scanUs = clock.nsecsElapsed() / 1e3;
+
+    // Unlink everything again.
+    clock.restart();
+    int removed = 0;
+    for (const User& u : cat.users) {
+        const QVector<int> held = cat.itemsOf(Relation::Hold, u.id);
+        for (int itemId : held) removed += cat.unlink(Relation::Hold, u.id, itemId);
+    }
+    const double unlinkNs = double(clock.nsecsElapsed()) / qMax(1, removed);
+
+    QJsonObject out;
+    out["scenario"] = "relations";
+    out["items"] = o.items;
+    out["users"] = o.users;
+    out["edges"] = edges;
+    out["bytes_per_user_empty"] = double(emptyBytes) / o.users;
+    out["bytes_per_edge"] = double(bytes - emptyBytes) / qMax(1, edges);
+    out["link_ns"] = linkNs;
+    out["unlink_ns"] = unlinkNs;
+    out["items_of_user_ns"] = byUserNs;
+    out["users_of_item_ns"] = byItemNs;
+    out["creator_items"] = byCreator.size();
+    out["creator_holders"] = viaIndex.size();
+    out["creator_holders_index_us"] = indexUs;
+    out["creator_holders_scan_us"] = scanUs;
+    out["agree"] = viaIndex == viaScan;
+    out["sink"] = double(sink & 1);
+    emitJson(out);
+}
+
+// ---------------------- names ----------------------
+// Login-field lookups over o.users names (try --users 1000000): prefix
+// completion and typo matching, top 8 each, as the login dialog asks.
+void runNames(const Options& o) {
+    Catalogue cat;
+    makeCatalogue(cat, 1, o.users, o.seed);
+    Rng rng(o.seed ^ 0x4A3);
+
+    QElapsedTimer clock;
+    clock.start();
+    const int queries = qMin(o.ops, 20000);
+    Samples prefix, fuzzy;
+    for (int q = 0; q < queries; ++q) {
+        const QString name = cat.users.at(rng.below(cat.users.size())).name;
+        const QString typed = name.left(3 + rng.below(4));
+        clock.restart();
+        const bool hit = !cat.usersByNamePrefix(typed, 8).isEmpty();
+        prefix.add(clock.nsecsElapsed(), hit);
+
+        // The name with two neighbouring letters swapped.
+        QString typo = name;
+        const int at = 1 + rng.below(qMax(1, int(name.size()) - 2));
+        if (at + 1 < name.size() && name.at(at) != ' ' && name.at(at + 1) != ' ')
+            typo = name.left(at) + name.at(at + 1) + name.at(at) + name.mid(at + 2);
+        clock.restart();
+        const bool found = !cat.usersNamedLike(typo, 2, 8).isEmpty();
+        fuzzy.add(clock.nsecsElapsed(), found);
+    }
+
+    // New users: merging the name index's runs happens here, not in queries.
+    Samples adds;
+    for (int i = 0; i < 1000; ++i) {
+        User u;
+        u.id = o.users + 1 + i;
+        u.name = QString("Late Joiner %1").arg(u.id);
+        clock.restart();
+        cat.addUser(u);
+        adds.add(clock.nsecsElapsed(), true);
+    }
+
+    QJsonObject out;
+    out["scenario"] = "names";
+    out["users"] = o.users;
+    out["prefix"] = prefix.summary();
+    out["fuzzy"] = fuzzy.summary();
+    out["add"] = adds.summary();
+    emitJson(out);
+}
+
+// ---------------------- search ----------------------
+// The search box as a patron types: 1-, 2- and 3-character prefixes of a
+// title word (the first keystrokes match the most tokens), and two-term
+// queries, over catalogues of each size (1M by default).
+void runSearch(const Options& o, const QList<int>& sizes) {
+    for (int n : sizes) {
+        Catalogue cat;
+        makeCatalogue(cat, n, 16, o.seed);
+        Rng rng(o.seed ^ 0x5EA);
+
+        QElapsedTimer clock;
+        clock.start();
+        const int queries = qMin(o.ops, 2000);
+        Samples prefix[3], multi;
+        qint64 hits = 0;
+        for (int q = 0; q < queries; ++q) {
+            const QStringList words = SearchIndex::tokenize(cat.items.at(rng.below(n)).title);
+            if (words.isEmpty()) continue;
+            const QString word = words.at(rng.below(words.size()));
+            for (int len = 1; len <= 3; ++len) {
+                clock.restart();
+                const int found = cat.search(word.left(len)).size();
+                prefix[len - 1].add(clock.nsecsElapsed(), found > 0);
+                hits += found;
+            }
+            // Another title's word, then the start of this one.
+            const QStringList other = SearchIndex::tokenize(cat.items.at(rng.below(n)).title);
+            const QString query = (other.isEmpty() ? word : other.first()) + " " + word.left(3);
+            clock.restart();
+            const int found = cat.search(query).size();
+            multi.add(clock.nsecsElapsed(), found > 0);
+            hits += found;
+        }
+
+        QJsonObject out;
+        out["scenario"] = "search";
+        out["items"] = n;
+        out["prefix1"] = prefix[0].summary();
+        out["prefix2"] = prefix[1].summary();
+        out["prefix3"] = prefix[2].summary();
+        out["multi_term"] = multi.summary();
+        out["hits"] = double(hits);
+        emitJson(out);
+    }
+}
+
+// ---------------------- holdqueue ----------------------
+// HoldQueue against the QList<int> it replaced, with n holders.
+void runHoldQueue(int n) {
+    QList<int> list;
+    HoldQueue queue;
+    for (int u = 1; u <= n; ++u) { list.append(u); queue.append(u); }
+
+    QElapsedTimer clock;
+    qint64 sink = 0;
+    auto time = [&](const std::function<void()>& fn) { clock.restart(); fn(); return double(clock.nsecsElapsed()) / n; };
+    clock.start();
+
+    const double listPos  = time([&]{ for (int u = 1; u <= n; ++u) sink += list.indexOf(u); });
+    const double queuePos = time([&]{ for (int u = 1; u <= n; ++u) sink += queue.indexOf(u); });
+    const double listHas  = time([&]{ for (int u = 1; u <= n; ++u) sink += list.contains(u); });
+    const double queueHas = time([&]{ for (int u = 1; u <= n; ++u) sink += queue.contains(u); });
+    // Cancel every other holder.
+    const double listCancel  = time([&]{ for (int u = 2; u <= n; u += 2) list.removeAll(u); }) * 2;
+    const double queueCancel = time([&]{ for (int u = 2; u <= n; u += 2) queue.removeAll(u); }) * 2;
+
+    QJsonObject out;
+    out["scenario"] = "holdqueue";
+    out["holders"] = n;
+    out["qlist_position_ns"] = listPos;
+    out["holdqueue_position_ns"] = queuePos;
+    out["qlist_contains_ns"] = listHas;
+    out["holdqueue_contains_ns"] = queueHas;
+    out["qlist_cancel_ns"] = listCancel;
+    out["holdqueue_cancel_ns"] = queueCancel;
+    out["sink"] = double(sink & 1);
+    emitJson(out);
+}
+
+// ---------------------- holds ----------------------
+// placeHold/cancelHold through LibraryController on one item with n
+// holders, so the catalogue's mirrors (snapshot draft, columns) are timed
+// with the queue, not just a standalone HoldQueue. "with_snapshots" takes a
+// snapshot before every op, as the GUI's change notices do, and so pays for
+// copying the queue it froze.
+void runHolds(const Options& o, int n) {
+    for (bool snapshots : {false, true}) {
+        Catalogue cat;
+        makeCatalogue(cat, 1, n + 1, o.seed);
+        LibraryController lib(&cat);
+        const int itemId = cat.items.first().id;
+        lib.borrow(1, itemId);   // holds only go on checked-out items
+
+        QElapsedTimer clock;
+        clock.start();
+        Samples fill, place, cancel;
+        for (int u = 2; u <= n + 1; ++u) {
+            clock.restart();
+            const bool ok = lib.placeHold(u, itemId).ok;
+            fill.add(clock.nsecsElapsed(), ok);
+        }
+        // Steady state at n holders: someone from the middle leaves and rejoins.
+        Rng rng(o.seed ^ 0x401D);
+        const int rounds = qMin(o.ops, 20000);
+        CatalogueSnapshot held;
+        for (int r = 0; r < rounds; ++r) {
+            const int u = 2 + rng.below(n);
+            if (snapshots) held = cat.snapshot();
+            clock.restart();
+            const bool left = lib.cancelHold(u, itemId).ok;
+            cancel.add(clock.nsecsElapsed(), left);
+            if (snapshots) held = cat.snapshot();
+            clock.restart();
+            const bool joined = lib.placeHold(u, itemId).ok;
+            place.add(clock.nsecsElapsed(), joined);
+        }
+
+        QJsonObject out;
+        out["scenario"] = "holds";
+        out["holders"] = n;
+        out["with_snapshots"] = snapshots;
+        out["fill"] = fill.summary();
+        out["place"] = place.summary();
+        out["cancel"] = cancel.summary();
+        emitJson(out);
+    }
+}
+
+QList<int> intList(const QString& csv) {
+    QList<int> out;
+    for (const QString& s : csv.split(','))
+        if (!s.trimmed().isEmpty()) out.append(s.toInt());
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription("HinLIBS benchmarks; prints JSON lines.");
+    cli.addHelpOption();
+    QCommandLineOption scenarioOpt("scenario", "circulation, memory, csv, store, lookup, scan, facets, batch, snapshot, invariants, reports, relations, names, search, holdqueue, holds or all.", "name", "circulation");
+    QCommandLineOption itemsOpt("items", "Generated items.", "n", "100000");
+    QCommandLineOption usersOpt("users", "Generated users.", "n", "10000");
+    QCommandLineOption opsOpt("ops", "Operations per run.", "n", "1000000");
+    QCommandLineOption seedOpt("seed", "Generator/workload seed.", "n", "42");
+    QCommandLineOption zipfOpt("zipf", "Item popularity skew (Zipf s).", "s", "1.0");
+    QCommandLineOption mixOpt("mix", "borrow,return,hold,cancel,query weights.", "w", "30,30,10,5,25");
+    QCommandLineOption sizesOpt("sizes", "Sizes for lookup/batch/search scenarios.", "list", "");
+    QCommandLineOption noInternOpt("no-intern", "Don't intern catalogue text (memory scenario).");
+    cli.addOptions({scenarioOpt, itemsOpt, usersOpt, opsOpt, seedOpt, zipfOpt, mixOpt, sizesOpt, noInternOpt});
+    cli.process(app);
+
+    Options o;
+    o.items = qMax(1, cli.value(itemsOpt).toInt());
+    o.users = qMax(1, cli.value(usersOpt).toInt());
+    o.ops   = qMax(1, cli.value(opsOpt).toInt());
+    o.seed  = cli.value(seedOpt).toULongLong();
+    o.zipf  = cli.value(zipfOpt).toDouble();
+    o.mix   = intList(cli.value(mixOpt));
+    o.intern = !cli.isSet(noInternOpt);
+    if (o.mix.size() != 5 || std::accumulate(o.mix.begin(), o.mix.end(), 0) <= 0) {
+        fprintf(stderr, "bench: --mix needs five non-negative weights\n");
+        return 2;
+    }
+
+    const QString which = cli.value(scenarioOpt);
+    const bool all = which == "all";
+    const QList<int> sizes = intList(cli.value(sizesOpt));
+
+    if (all || which == "circulation") runCirculation(o);
+    if (all || which == "memory")      runMemory(o);
+    if (all || which == "csv")         runCsv(o);
+    if (all || which == "store")       runStore(o);
+    if (all || which == "lookup")      runLookup(o, sizes.isEmpty() ? QList<int>{1000, 100000, 1000000} : sizes);
+    if (all || which == "scan")        runScan(o);
+    if (all || which == "facets")      runFacets(o);
+    if (all || which == "batch")       runBatch(o, sizes.isEmpty() ? QList<int>{10, 1000, 100000} : sizes);
+    bool ok = true;
+    if (all || which == "snapshot")    ok = runSnapshot(o, qMax(1, QThread::idealThreadCount() - 1)) && ok;
+    if (all || which == "invariants")  ok = runInvariants(o) && ok;
+    if (all || which == "reports")     runReports(o);
+    if (all || which == "relations")   runRelations(o);
+    if (all || which == "names")       runNames(o);
+    if (all || which == "search")      runSearch(o, sizes.isEmpty() ? QList<int>{1000000} : sizes);
+    if (all || which == "holdqueue")   runHoldQueue(10000);
+    if (all || which == "holds")       runHolds(o, 10000);
+    return ok ? 0 : 1;
+}
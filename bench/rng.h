@@ -0,0 +1,45 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <cmath>
+#include <algorithm>
+
+// SplitMix64: tiny, fast and identical on every platform, so a seed always
+// produces the same catalogue and the same workload.
+class Rng {
+public:
+    explicit Rng(quint64 seed = 1) : s_(seed) {}
+    quint64 next() {
+        quint64 z = (s_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    int    below(int n) { return n > 0 ? int(next() % quint64(n)) : 0; }   // [0, n)
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }  // [0, 1)
+
+private:
+    quint64 s_;
+};
+
+// Ranks 0..n-1 drawn with P(k) ~ 1 / (k+1)^s: a few items are very popular.
+class ZipfSampler {
+public:
+    ZipfSampler(int n, double s) : cdf_(qMax(1, n)) {
+        double sum = 0;
+        for (int k = 0; k < cdf_.size(); ++k) cdf_[k] = (sum += 1.0 / std::pow(k + 1.0, s));
+        for (double& c : cdf_) c /= sum;
+    }
+    int sample(Rng& rng) const {
+        const double u = rng.unit();
+        const int k = int(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+        return qMin(k, int(cdf_.size()) - 1);
+    }
+
+private:
+    QVector<double> cdf_;
+};
+
+#endif // RNG_H
@@ -1,49 +1,347 @@
 #include "catalogue.h"
 #include <QDate>
+#include <QMutexLocker>
+#include <algorithm>
+#include "metrics.h"
 
-static QString ci(const QString& s) { return s.trimmed().toLower(); }
+static QString ci(const QString& s) { return s.trimmed().toLower(); }   // login key; NameIndex::normalize also folds inner spaces
+
+// Slots are positions in items/users. A slot that no longer matches its id
+// means the list was edited behind our back: one scan notes where every
+// displaced id now sits, so later lookups are O(1) again. Ids the index has
+// never seen are unknown until reindex().
+template <typename T>
+static int movedSlot(const QList<T>& list, const QHash<int, int>& index, QHash<int, int>& moved, int id) {
+    const int slot = moved.value(id, -1);
+    if (slot >= 0 && slot < list.size() && list.at(slot).id == id) return slot;
+    HL_COUNT(SlotScan);
+    moved.clear();
+    for (int i = 0; i < list.size(); ++i) {
+        const int at = list.at(i).id;
+        if (index.value(at, -1) != i) moved.insert(at, i);
+    }
+    return moved.value(id, -1);
+}
+
+int Catalogue::itemSlot(int id) const {
+    const int slot = itemSlot_.value(id, -1);
+    if (slot < 0) return -1;
+    if (slot < items.size() && items.at(slot).id == id) return slot;
+    QMutexLocker locker(&movedLock_);
+    return movedSlot(items, itemSlot_, movedItems_, id);
+}
+int Catalogue::userSlot(int id) const {
+    const int slot = userSlot_.value(id, -1);
+    if (slot < 0) return -1;
+    if (slot < users.size() && users.at(slot).id == id) return slot;
+    QMutexLocker locker(&movedLock_);
+    return movedSlot(users, userSlot_, movedUsers_, id);
+}
 
 Item* Catalogue::findItem(int id) {
-    for (auto &it : items) if (it.id == id) return &it;
-    return nullptr;
+    HL_COUNT(FindItem);
+    const int slot = itemSlot(id);
+    return slot >= 0 ? &items[slot] : nullptr;
 }
 const Item* Catalogue::findItem(int id) const {
-    for (auto const &it : items) if (it.id == id) return &it;
-    return nullptr;
+    HL_COUNT(FindItem);
+    const int slot = itemSlot(id);
+    return slot >= 0 ? &items.at(slot) : nullptr;
 }
 User* Catalogue::findUserById(int id) {
-    for (auto &u : users) if (u.id == id) return &u;
-    return nullptr;
+    HL_COUNT(FindUser);
+    const int slot = userSlot(id);
+    return slot >= 0 ? &users[slot] : nullptr;
 }
 const User* Catalogue::findUserById(int id) const {
-    for (auto const &u : users) if (u.id == id) return &u;
-    return nullptr;
+    HL_COUNT(FindUser);
+    const int slot = userSlot(id);
+    return slot >= 0 ? &users.at(slot) : nullptr;
 }
 User* Catalogue::findUserByName(const QString& name) {
-    const QString needle = ci(name);
-    for (auto &u : users) if (ci(u.name) == needle) return &u;
-    return nullptr;
+    return findUserById(userByName_.value(ci(name), -1));
+}
+const User* Catalogue::findUserByName(const QString& name) const {
+    return findUserById(userByName_.value(ci(name), -1));
+}
+
+Item* Catalogue::addItem(const Item& it) {
+    if (itemSlot_.contains(it.id)) return nullptr;   // ids are unique
+    itemSlot_.insert(it.id, items.size());
+    items.push_back(it);
+    if (interning_) intern(items.last());
+    if (columnar_) columns_.append(it);
+    search_.add(it);
+    facets_.append(items.last());
+    dewey_.add(it);
+    versions_.appendItem(items.last());
+    relations_.resize(users.size(), items.size());
+    return &items.last();
+}
+
+bool Catalogue::removeItem(int id) {
+    const int slot = itemSlot(id);
+    if (slot < 0) return false;
+    items.removeAt(slot);
+    if (columnar_) columns_.removeAt(slot);
+    search_.remove(id);
+    dewey_.remove(id);
+    itemSlot_.remove(id);
+    for (int i = slot; i < items.size(); ++i) itemSlot_.insert(items.at(i).id, i);
+    facets_.rebuild(items);   // rows after the slot all shift down
+    versions_.rebuild(items, users);
+    rebuildRelations();
+    return true;
+}
+
+User* Catalogue::addUser(const User& u) {
+    if (userSlot_.contains(u.id)) return nullptr;
+    userSlot_.insert(u.id, users.size());
+    const QString key = ci(u.name);
+    if (!userByName_.contains(key)) userByName_.insert(key, u.id);
+    users.push_back(u);
+    names_.add(u.id, u.name);
+    versions_.appendUser(u);
+    const int slot = users.size() - 1;
+    relations_.resize(users.size(), items.size());
+    for (int itemId : u.loans) relations_.add(Relation::Loan, slot, itemSlot(itemId));
+    for (int itemId : u.holds) relations_.add(Relation::Hold, slot, itemSlot(itemId));
+    return &users.last();
+}
+
+bool Catalogue::removeUser(int id) {
+    const int slot = userSlot(id);
+    if (slot < 0) return false;
+    const QString key = ci(users.at(slot).name);
+    if (userByName_.value(key, -1) == id) userByName_.remove(key);
+    users.removeAt(slot);
+    userSlot_.remove(id);
+    for (int i = slot; i < users.size(); ++i) userSlot_.insert(users.at(i).id, i);
+    names_.rebuild(users);
+    versions_.rebuild(items, users);
+    rebuildRelations();
+    return true;
+}
+
+void Catalogue::reindex() {
+    itemSlot_.clear();
+    userSlot_.clear();
+    {
+        QMutexLocker locker(&movedLock_);
+        movedItems_.clear();
+        movedUsers_.clear();
+    }
+    userByName_.clear();
+    itemSlot_.reserve(items.size());
+    userSlot_.reserve(users.size());
+    userByName_.reserve(users.size());
+    for (int i = 0; i < items.size(); ++i) itemSlot_.insert(items.at(i).id, i);
+    for (int i = 0; i < users.size(); ++i) {
+        userSlot_.insert(users.at(i).id, i);
+        // First user wins on duplicate names, matching the old linear scan.
+        const QString key = ci(users.at(i).name);
+        if (!userByName_.contains(key)) userByName_.insert(key, users.at(i).id);
+    }
+    names_.rebuild(users);
+    text_.clear();
+    if (interning_) for (auto& it : items) intern(it);
+    if (columnar_) columns_.rebuild(items);
+    search_.rebuild(items);
+    facets_.rebuild(items);
+    dewey_.rebuild(items);
+    versions_.rebuild(items, users);
+    rebuildRelations();
+}
+
+// Titles are left alone: they are mostly unique, so pooling them would cost
+// a table entry per item and save nothing.
+void Catalogue::intern(Item& it) {
+    it.creator = text_.shared(it.creator);
+    it.dewey   = text_.shared(it.dewey);
+    it.issue   = text_.shared(it.issue);
+    it.genre   = text_.shared(it.genre);
+    it.rating  = text_.shared(it.rating);
+}
+
+void Catalogue::setInterning(bool on) {
+    if (on == interning_) return;
+    interning_ = on;
+    text_.clear();
+    if (on) for (auto& it : items) intern(it);
+}
+
+void Catalogue::touchItem(int id, int userId) {
+    const int slot = itemSlot(id);
+    if (slot < 0) return;
+    if (columnar_) columns_.update(slot, items.at(slot));
+    search_.update(items.at(slot));
+    facets_.update(slot, items.at(slot));
+    dewey_.update(items.at(slot));
+    const int uslot = userId >= 0 ? userSlot(userId) : -1;
+    versions_.update(slot, items.at(slot), uslot, uslot >= 0 ? &users.at(uslot) : nullptr);
+}
+
+void Catalogue::touchCirculation(int id, int userId) {
+    const int slot = itemSlot(id);
+    if (slot < 0) return;
+    const Item& it = items.at(slot);
+    {
+        QMutexLocker lock(&statusLock_);
+        if (columnar_) columns_.updateCirculation(slot, it, userId);   // this row only
+        facets_.updateStatus(slot, it.status);
+    }
+    const int uslot = userId >= 0 ? userSlot(userId) : -1;
+    versions_.circulation(slot, it, uslot, uslot >= 0 ? &users.at(uslot) : nullptr);
+}
+
+void Catalogue::setColumnar(bool on) {
+    if (on == columnar_) return;
+    columnar_ = on;
+    if (on) columns_.rebuild(items);
+    else    columns_.clear();
+}
+
+QVector<int> Catalogue::availableOfType(ItemType t) const {
+    if (columnar_) {
+        QMutexLocker lock(&statusLock_);
+        return columns_.availableOfType(t);
+    }
+    QVector<int> out;
+    for (const auto& it : items)
+        if (it.type == t && it.status == Availability::Available) out.append(it.id);
+    return out;
+}
+
+QVector<int> Catalogue::search(const QString& query) const {
+    HL_TIMED(Search);
+    return search_.search(query);
+}
+
+QVector<int> Catalogue::browse(const FacetQuery& q) const {
+    HL_TIMED(Browse);
+    QVector<quint32> rows;
+    {
+        QMutexLocker lock(&statusLock_);
+        rows = facets_.rows(q);
+    }
+    QVector<int> out;
+    out.reserve(rows.size());
+    for (quint32 r : rows) if (int(r) < items.size()) out.append(items.at(int(r)).id);
+    return out;
+}
+
+int Catalogue::browseCount(const FacetQuery& q) const {
+    QMutexLocker lock(&statusLock_);
+    return facets_.count(q);
+}
+
+QVector<FacetCount> Catalogue::facetCounts(Facet f, const FacetQuery& within) const {
+    QMutexLocker lock(&statusLock_);
+    return facets_.counts(f, within);
+}
+
+QVector<int> Catalogue::deweyRange(const QString& low, const QString& high) const {
+    return dewey_.range(DeweyIndex::keyOf(low), DeweyIndex::upperKeyOf(high));
+}
+
+// Ids in loans/holds whose item is gone are left out.
+void Catalogue::rebuildRelations() {
+    QMutexLocker locker(&relationsLock_);
+    relations_.clear();
+    relations_.resize(users.size(), items.size());
+    QVector<RelationStore::Edge> loans, holds;
+    for (int u = 0; u < users.size(); ++u) {
+        for (int itemId : users.at(u).loans) loans.append({u, itemSlot(itemId)});
+        for (int itemId : users.at(u).holds) holds.append({u, itemSlot(itemId)});
+    }
+    relations_.rebuild(Relation::Loan, loans);
+    relations_.rebuild(Relation::Hold, holds);
+}
+
+// A user added before an item it lists has that entry in its list but no
+// edge (addUser() can only link items it finds), so the list is kept in step
+// on its own rather than only when the edge changed.
+bool Catalogue::link(Relation r, int userId, int itemId) {
+    const int u = userSlot(userId);
+    QMutexLocker locker(&relationsLock_);
+    if (!relations_.add(r, u, itemSlot(itemId))) return false;
+    QList<int>& list = r == Relation::Loan ? users[u].loans : users[u].holds;
+    if (!list.contains(itemId)) list.append(itemId);
+    return true;
+}
+
+bool Catalogue::unlink(Relation r, int userId, int itemId) {
+    const int u = userSlot(userId);
+    if (u < 0) return false;
+    QMutexLocker locker(&relationsLock_);
+    const bool edge = relations_.remove(r, u, itemSlot(itemId));
+    const bool listed = (r == Relation::Loan ? users[u].loans : users[u].holds).removeOne(itemId);
+    return edge || listed;
+}
+
+bool Catalogue::linked(Relation r, int userId, int itemId) const {
+    QMutexLocker locker(&relationsLock_);
+    return relations_.has(r, userSlot(userId), itemSlot(itemId));
+}
+
+QVector<int> Catalogue::itemsOf(Relation r, int userId) const {
+    QMutexLocker locker(&relationsLock_);
+    int n;
+    const int* rows = relations_.itemsOf(r, userSlot(userId), &n);
+    QVector<int> out(n);
+    for (int i = 0; i < n; ++i) out[i] = items.at(rows[i]).id;
+    return out;
+}
+
+QVector<int> Catalogue::usersOf(Relation r, int itemId) const {
+    QMutexLocker locker(&relationsLock_);
+    int n;
+    const int* rows = relations_.usersOf(r, itemSlot(itemId), &n);
+    QVector<int> out(n);
+    for (int i = 0; i < n; ++i) out[i] = users.at(rows[i]).id;
+    return out;
+}
+
+QVector<int> Catalogue::usersOfAny(Relation r, const QVector<int>& itemIds) const {
+    QVector<int> out;
+    {
+        QMutexLocker locker(&relationsLock_);
+        for (int itemId : itemIds) {
+            int n;
+            const int* rows = relations_.usersOf(r, itemSlot(itemId), &n);
+            for (int i = 0; i < n; ++i) out.append(users.at(rows[i]).id);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+qint64 Catalogue::relationBytes() const {
+    QMutexLocker locker(&relationsLock_);
+    return relations_.bytes();
 }
 
 void Catalogue::seedDefaultData() {
     items.clear(); users.clear();
+    reindex();
 
     int id = 100;
 
     auto mkFic = [&](const QString& t, const QString& a){
-        Item it; it.id=id++; it.type=ItemType::Fiction; it.title=t; it.creator=a; items.push_back(it);
+        Item it; it.id=id++; it.type=ItemType::Fiction; it.title=t; it.creator=a; addItem(it);
     };
     auto mkNF  = [&](const QString& t, const QString& a, const QString& ddc){
-        Item it; it.id=id++; it.type=ItemType::NonFiction; it.title=t; it.creator=a; it.dewey=ddc; items.push_back(it);
+        Item it; it.id=id++; it.type=ItemType::NonFiction; it.title=t; it.creator=a; it.dewey=ddc; addItem(it);
     };
     auto mkMag = [&](const QString& t, const QString& pubr, const QString& issue, const QDate& pubd){
-        Item it; it.id=id++; it.type=ItemType::Magazine; it.title=t; it.creator=pubr; it.issue=issue; it.pub=pubd; items.push_back(it);
+        Item it; it.id=id++; it.type=ItemType::Magazine; it.title=t; it.creator=pubr; it.issue=issue; it.pub=pubd; addItem(it);
     };
     auto mkMov = [&](const QString& t, const QString& dir, const QString& genre, const QString& rating){
-        Item it; it.id=id++; it.type=ItemType::Movie; it.title=t; it.creator=dir; it.genre=genre; it.rating=rating; items.push_back(it);
+        Item it; it.id=id++; it.type=ItemType::Movie; it.title=t; it.creator=dir; it.genre=genre; it.rating=rating; addItem(it);
     };
     auto mkGame = [&](const QString& t, const QString& studio, const QString& genre, const QString& rating){
-        Item it; it.id=id++; it.type=ItemType::VideoGame; it.title=t; it.creator=studio; it.genre=genre; it.rating=rating; items.push_back(it);
+        Item it; it.id=id++; it.type=ItemType::VideoGame; it.title=t; it.creator=studio; it.genre=genre; it.rating=rating; addItem(it);
     };
 
     // 5 Fiction
@@ -77,15 +375,15 @@ void Catalogue::seedDefaultData() {
     mkGame("Neon Courier",    "Delta North",   "Action",      "T");
 
     // 7 Users: 5 patrons, 1 librarian, 1 admin
-    auto addUser = [&](int id_, const QString& name, UserType t){
-        User u; u.id=id_; u.name=name; u.type=t; users.push_back(u);
+    auto mkUser = [&](int id_, const QString& name, UserType t){
+        User u; u.id=id_; u.name=name; u.type=t; addUser(u);
     };
     int uid = 1;
-    addUser(uid++, "Alice",  UserType::Patron);
-    addUser(uid++, "Bob",    UserType::Patron);
-    addUser(uid++, "Carmen", UserType::Patron);
-    addUser(uid++, "Diego",  UserType::Patron);
-    addUser(uid++, "Eva",    UserType::Patron);
-    addUser(uid++, "Liam",   UserType::Librarian);
-    addUser(uid++, "Sara",   UserType::Admin);
+    mkUser(uid++, "Alice",  UserType::Patron);
+    mkUser(uid++, "Bob",    UserType::Patron);
+    mkUser(uid++, "Carmen", UserType::Patron);
+    mkUser(uid++, "Diego",  UserType::Patron);
+    mkUser(uid++, "Eva",    UserType::Patron);
+    mkUser(uid++, "Liam",   UserType::Librarian);
+    mkUser(uid++, "Sara",   UserType::Admin);
 }
@@ -3,8 +3,18 @@
 
 #include <QList>
 #include <QString>
+#include <QHash>
+#include <QMutex>
 #include "item.h"
 #include "user.h"
+#include "itemcolumns.h"
+#include "searchindex.h"
+#include "facetindex.h"
+#include "deweyindex.h"
+#include "texttable.h"
+#include "cataloguesnapshot.h"
+#include "relationstore.h"
+#include "nameindex.h"
 
 class Catalogue {
 public:
@@ -19,8 +29,128 @@ public:
 
     // Case-insensitive match on name
     User* findUserByName(const QString& name);
+    const User* findUserByName(const QString& name) const;
+
+    // For the login field (see NameIndex): up to k user ids whose name, or
+    // the name from one of its words on, starts with `prefix`; or matches
+    // `name` word for word within maxEdits typos, closest first.
+    QVector<int> usersByNamePrefix(const QString& prefix, int k = 10) const { return names_.complete(prefix, k); }
+    QVector<int> usersNamedLike(const QString& name, int maxEdits = 2, int k = 10) const {
+        return names_.closest(name, maxEdits, k);
+    }
+
+    // Mutators that keep the lookup indexes in step with items/users.
+    Item* addItem(const Item& it);
+    bool  removeItem(int id);
+    User* addUser(const User& u);
+    bool  removeUser(int id);
+
+    // Rebuild every index; call after editing items/users directly.
+    void reindex();
+
+    // Position of an id in items/users, or -1. Ids added to the lists
+    // directly are only found after reindex().
+    int itemSlot(int id) const;
+    int userSlot(int id) const;
+
+    // Call after mutating an Item in place so derived structures follow.
+    // Pass the user whose loans/holds changed with it, if any, so snapshots
+    // see both at once.
+    void touchItem(int id, int userId = -1);
+    // The same for a change to only status, borrower, due date or hold
+    // queue (circulation): text-derived indexes (search, Dewey, genre and
+    // rating facets) are left alone. The hold queue and the user's lists
+    // may only have gained or lost userId and id respectively; mirrors
+    // replay just that instead of copying them. Safe to call from several threads at
+    // once for different items, e.g. under LibraryController's stripe locks.
+    void touchCirculation(int id, int userId = -1);
+
+    // Consistent, immutable copy of items and users for readers on other
+    // threads (see CatalogueSnapshot). Safe to call while a LibraryController
+    // circulates; edits made outside touchItem() and the mutators above show
+    // up after the next reindex().
+    CatalogueSnapshot snapshot() const { return versions_.snapshot(); }
+
+    // Optional column-oriented mirror of items for scan-heavy callers.
+    void setColumnar(bool on);
+    bool columnar() const { return columnar_; }
+    const ItemColumns& columns() const { return columns_; }
+
+    // Repetitive text (creator, Dewey, issue, genre, rating) is interned so
+    // equal values share one string buffer across items. On by default.
+    void setInterning(bool on);
+    bool interning() const { return interning_; }
+    int  distinctText() const { return text_.size(); }
+
+    // Ids of every available item of type t, in catalogue order. Columnar,
+    // this is safe alongside touchCirculation(); the record scan reads
+    // Item::status unlocked, so with a concurrent controller use snapshot().
+    QVector<int> availableOfType(ItemType t) const;
+
+    // Full-text match over title/creator/genre/dewey/issue (see SearchIndex).
+    QVector<int> search(const QString& query) const;
+
+    // Faceted browsing by type, availability, genre, rating and Dewey class
+    // (see FacetIndex). browse() returns ids in catalogue order. These hold
+    // the status lock while reading the bitmaps, so they are safe alongside
+    // touchCirculation().
+    QVector<int> browse(const FacetQuery& q) const;
+    int browseCount(const FacetQuery& q) const;
+    QVector<FacetCount> facetCounts(Facet f, const FacetQuery& within = FacetQuery()) const;
+
+    // Shelf order of items with a Dewey number (see DeweyIndex). Range bounds
+    // are inclusive and a bound covers what it prefixes: "500".."599" is the
+    // whole 500s. Empty if either bound isn't a class number.
+    QVector<int> deweyRange(const QString& low, const QString& high) const;
+    QVector<int> shelfOrder() const { return dewey_.inOrder(); }
+    QVector<int> shelvedNear(int itemId, int radius = 5) const { return dewey_.near(itemId, radius); }
+    // An item's shelf-order key, as already parsed; DeweyIndex::kNoKey if none.
+    quint64 deweyKey(int itemId) const { return dewey_.keyFor(itemId); }
+
+    // Loans and holds as a user <-> item graph (see RelationStore). link() and
+    // unlink() change an edge and the user's loans/holds list together; link()
+    // returns false if the edge was already there, unlink() if neither was,
+    // and both if an id is unknown.
+    // Safe alongside a concurrent LibraryController, which goes through them.
+    bool link(Relation r, int userId, int itemId);
+    bool unlink(Relation r, int userId, int itemId);
+    bool linked(Relation r, int userId, int itemId) const;
+    QVector<int> itemsOf(Relation r, int userId) const;
+    QVector<int> usersOf(Relation r, int itemId) const;
+    // Everyone with an r edge to any of the items, ascending, once each;
+    // e.g. usersOfAny(Relation::Hold, search("Tolkien")).
+    QVector<int> usersOfAny(Relation r, const QVector<int>& itemIds) const;
+    qint64 relationBytes() const;
 
     void seedDefaultData(); // builds 20 items + 7 users
+
+private:
+    QHash<int, int>     itemSlot_;    // item id -> index into items
+    QHash<int, int>     userSlot_;    // user id -> index into users
+    QHash<QString, int> userByName_;  // trimmed, lower-cased name -> user id
+    mutable QMutex movedLock_;
+    mutable QHash<int, int> movedItems_;   // id -> slot, for ids whose itemSlot_ went stale
+    mutable QHash<int, int> movedUsers_;
+    NameIndex names_;
+
+    void intern(Item& it);
+    void rebuildRelations();   // from every User::loans/holds
+
+    bool interning_ = true;
+    TextTable text_;
+
+    bool columnar_ = false;
+    ItemColumns columns_;
+    SearchIndex search_;
+    FacetIndex facets_;
+    DeweyIndex dewey_;
+    CatalogueVersions versions_;
+    RelationStore relations_;
+    mutable QMutex relationsLock_;
+    // touchCirculation() writes the status facet bitmaps (rows share words,
+    // and blocks change representation) and the circulation columns; their
+    // readers take it too.
+    mutable QMutex statusLock_;
 };
 
 #endif // CATALOGUE_H
@@ -0,0 +1,453 @@
+#include "cataloguecsv.h"
+#include "catalogue.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum Column { ColId, ColType, ColTitle, ColCreator, ColDewey, ColIssue, ColPub, ColGenre, ColRating, ColumnCount };
+const char* const kColumnNames[ColumnCount] = {
+    "id", "type", "title", "creator", "dewey", "issue", "pub", "genre", "rating"
+};
+
+// Length of the longest prefix of [p, end) that ends on a record boundary
+// at or after `want` bytes (newlines inside quotes don't count). With `eof`
+// the input ends at `end`, so a trailing partial line is a whole record;
+// otherwise -1 means "need more bytes".
+//
+// Quotes follow RecordReader's rules: one opens a quoted field only at the
+// start of a field, and after the closing quote anything but a separator
+// is junk up to the end of the line. So a stray quote in an unquoted field
+// (12" Single) is just a character here too.
+qint64 cutAfter(const char* p, const char* end, qint64 want, bool eof) {
+    enum { FieldStart, Unquoted, Quoted, AfterQuote, Junk } state = FieldStart;
+    for (const char* q = p; q < end; ++q) {
+        const char c = *q;
+        if (state == Quoted) {
+            if (c != '"') continue;
+            if (q + 1 < end && q[1] == '"') ++q;   // "" stays inside
+            else state = AfterQuote;
+            continue;
+        }
+        if (c == '\n') {
+            if (q - p + 1 >= want) return q - p + 1;
+            state = FieldStart;
+        } else if (state == Junk) {
+            continue;
+        } else if (c == ',' || c == '\r') {
+            state = FieldStart;
+        } else if (state == FieldStart) {
+            state = c == '"' ? Quoted : Unquoted;
+        } else if (state == AfterQuote) {
+            state = Junk;
+        }
+    }
+    return eof ? end - p : -1;
+}
+
+// Where the bytes come from: the mapped file, or (when mapping isn't
+// possible) a buffer that is refilled with whole records.
+class Source {
+public:
+    bool open(const QString& path, QString* error) {
+        file_.setFileName(path);
+        if (!file_.open(QIODevice::ReadOnly)) {
+            if (error) *error = "Could not open " + path + ": " + file_.errorString();
+            return false;
+        }
+        size_ = file_.size();
+        if (size_ > 0) map_ = reinterpret_cast<const char*>(file_.map(0, size_));
+        return true;
+    }
+
+    // Next run of whole records, roughly `want` bytes; n == 0 at the end.
+    void next(qint64 want, const char** p, qint64* n) {
+        if (map_) {
+            const qint64 len = cutAfter(map_ + pos_, map_ + size_, want, true);
+            *p = map_ + pos_;
+            *n = len;
+            pos_ += len;
+            return;
+        }
+        buf_.remove(0, int(consumed_));
+        bool eof = false;
+        qint64 len = -1;
+        for (qint64 need = want; len < 0; need *= 2) {
+            while (!eof && buf_.size() < need) {
+                const int at = buf_.size();
+                buf_.resize(int(qMax<qint64>(need, at + 65536)));
+                const qint64 got = file_.read(buf_.data() + at, buf_.size() - at);
+                buf_.resize(at + int(qMax<qint64>(got, 0)));
+                eof = got <= 0;
+            }
+            len = cutAfter(buf_.constData(), buf_.constData() + buf_.size(), want, eof);
+        }
+        consumed_ = len;
+        *p = buf_.constData();
+        *n = len;
+    }
+
+private:
+    QFile file_;
+    const char* map_ = nullptr;
+    qint64 size_ = 0, pos_ = 0;
+    QByteArray buf_;
+    qint64 consumed_ = 0;
+};
+
+// Splits records into fields without copying; only quoted fields with
+// doubled quotes are unescaped (into a per-record scratch buffer).
+class RecordReader {
+public:
+    struct Field { const char* p; int n; int scratch; };   // scratch offset or -1
+
+    RecordReader(const char* p, const char* end) : p_(p), end_(end) {}
+    bool atEnd() const { return p_ >= end_; }
+    const char* pos() const { return p_; }
+
+    // Reads one record; *lines gets the newlines it spanned. False if the
+    // quoting is broken, after skipping to the end of the line.
+    bool next(QVector<Field>& fields, int* lines) {
+        fields.clear();
+        scratch_.clear();
+        *lines = 0;
+        for (;;) {
+            Field f = { p_, 0, -1 };
+            if (p_ < end_ && *p_ == '"') {
+                const char* start = ++p_;
+                bool escaped = false;
+                for (;;) {
+                    const char* q = static_cast<const char*>(memchr(p_, '"', size_t(end_ - p_)));
+                    if (!q) { *lines += int(std::count(p_, end_, '\n')); p_ = end_; return false; }
+                    *lines += int(std::count(p_, q, '\n'));
+                    if (q + 1 < end_ && q[1] == '"') { escaped = true; p_ = q + 2; continue; }
+                    p_ = q + 1;
+                    if (escaped) {
+                        f.scratch = scratch_.size();
+                        for (const char* c = start; c < q; ++c) {
+                            scratch_.append(*c);
+                            if (*c == '"') ++c;   // "" -> "
+                        }
+                        f.n = scratch_.size() - f.scratch;
+                    } else {
+                        f.p = start;
+                        f.n = int(q - start);
+                    }
+                    break;
+                }
+            } else {
+                const char* q = p_;
+                while (q < end_ && *q != ',' && *q != '\n' && *q != '\r') ++q;
+                f.n = int(q - p_);
+                p_ = q;
+            }
+            fields.append(f);
+
+            if (p_ >= end_) return true;
+            const char c = *p_++;
+            if (c == ',') continue;
+            if (c == '\n') { ++*lines; return true; }
+            if (c == '\r') {
+                if (p_ < end_ && *p_ == '\n') ++p_;
+                ++*lines;
+                return true;
+            }
+            // Junk after a closing quote: drop the rest of the line.
+            while (p_ < end_ && *p_ != '\n') ++p_;
+            if (p_ < end_) { ++p_; ++*lines; }
+            return false;
+        }
+    }
+
+    const char* data(const Field& f) const { return f.scratch < 0 ? f.p : scratch_.constData() + f.scratch; }
+
+private:
+    const char* p_;
+    const char* end_;
+    QByteArray scratch_;
+};
+
+typedef RecordReader::Field Field;
+
+struct Row {
+    Item item;
+    int line = 0;          // relative to the start of its chunk
+    bool hasId = false;
+    QString error;         // non-empty: rejected, with this reason
+};
+
+struct Chunk {
+    const char* p = nullptr;
+    qint64 n = 0;
+    QVector<Row> rows;
+    int lines = 0;         // newlines in the chunk
+};
+
+struct Layout {
+    int at[ColumnCount];   // field index of each column, or -1
+    int width = 0;         // fields a row needs
+};
+
+bool parseInt(const char* p, int n, int* out) {
+    if (n <= 0 || n > 9) return false;
+    int v = 0;
+    for (int i = 0; i < n; ++i) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        v = v * 10 + (p[i] - '0');
+    }
+    *out = v;
+    return true;
+}
+
+// Accepts "yyyy-MM-dd".
+bool parseDate(const char* p, int n, QDate* out) {
+    int y, m, d;
+    if (n != 10 || p[4] != '-' || p[7] != '-') return false;
+    if (!parseInt(p, 4, &y) || !parseInt(p + 5, 2, &m) || !parseInt(p + 8, 2, &d)) return false;
+    *out = QDate(y, m, d);
+    return out->isValid();
+}
+
+// Matches the names toString(ItemType) produces, ignoring case, spaces and
+// hyphens ("Non-Fiction", "nonfiction", "Video Game", ...).
+bool parseType(const char* p, int n, ItemType* out) {
+    char key[16];
+    int k = 0;
+    for (int i = 0; i < n; ++i) {
+        const char c = p[i];
+        if (c == ' ' || c == '-' || c == '_') continue;
+        if (k == int(sizeof(key)) - 1) return false;
+        key[k++] = char(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+    }
+    key[k] = 0;
+    static const struct { const char* name; ItemType type; } kTypes[] = {
+        { "fiction", ItemType::Fiction }, { "nonfiction", ItemType::NonFiction },
+        { "magazine", ItemType::Magazine }, { "movie", ItemType::Movie },
+        { "videogame", ItemType::VideoGame }
+    };
+    for (const auto& t : kTypes)
+        if (strcmp(key, t.name) == 0) { *out = t.type; return true; }
+    return false;
+}
+
+void parseChunk(Chunk* chunk, const Layout& layout) {
+    RecordReader in(chunk->p, chunk->p + chunk->n);
+    QVector<Field> fields;
+    fields.reserve(ColumnCount);
+    chunk->rows.reserve(int(chunk->n / 64));
+
+    int line = 0;
+    while (!in.atEnd()) {
+        int spanned = 0;
+        const bool ok = in.next(fields, &spanned);
+        const int at = line;
+        line += spanned;
+        if (ok && fields.size() == 1 && fields.at(0).n == 0) continue;   // blank line
+
+        chunk->rows.append(Row());
+        Row& row = chunk->rows.last();
+        row.line = at;
+        if (!ok) { row.error = "malformed quoting"; continue; }
+        if (fields.size() < layout.width) {
+            row.error = QString("expected %1 fields, found %2").arg(layout.width).arg(fields.size());
+            continue;
+        }
+
+        auto raw = [&](Column c, const char** p, int* n) {
+            const int i = layout.at[c];
+            if (i < 0) { *p = nullptr; *n = 0; return; }
+            *p = in.data(fields.at(i));
+            *n = fields.at(i).n;
+        };
+        auto text = [&](Column c) {
+            const char* p; int n;
+            raw(c, &p, &n);
+            return n ? QString::fromUtf8(p, n) : QString();
+        };
+
+        const char* p; int n;
+        Item& it = row.item;
+        raw(ColId, &p, &n);
+        if (n) {
+            if (!parseInt(p, n, &it.id) || it.id <= 0) { row.error = "bad id"; continue; }
+            row.hasId = true;
+        }
+        raw(ColType, &p, &n);
+        if (!parseType(p, n, &it.type)) { row.error = "unknown type"; continue; }
+        it.title = text(ColTitle);
+        if (it.title.trimmed().isEmpty()) { row.error = "missing title"; continue; }
+        it.creator = text(ColCreator);
+        it.dewey   = text(ColDewey);
+        it.issue   = text(ColIssue);
+        it.genre   = text(ColGenre);
+        it.rating  = text(ColRating);
+        raw(ColPub, &p, &n);
+        if (n && !parseDate(p, n, &it.pub)) { row.error = "bad pub date (want yyyy-MM-dd)"; continue; }
+    }
+    chunk->lines = line;
+}
+
+void putField(QByteArray& out, const QString& s) {
+    const QByteArray utf8 = s.toUtf8();
+    bool quote = false;
+    for (char c : utf8)
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') { quote = true; break; }
+    if (!quote) { out += utf8; return; }
+    out += '"';
+    for (char c : utf8) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+void putDate(QByteArray& out, const QDate& d) {
+    if (!d.isValid()) return;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d", d.year(), d.month(), d.day());
+    out += buf;
+}
+
+} // namespace
+
+bool CatalogueCsv::importFile(Catalogue& cat, const QString& path, ImportReport* report,
+                              QString* error, const ImportOptions& options) {
+    ImportReport local;
+    ImportReport& rep = report ? *report : local;
+    rep = ImportReport();
+
+    Source src;
+    if (!src.open(path, error)) return false;
+
+    const int threads = qMax(1, options.threads > 0 ? options.threads : QThread::idealThreadCount());
+    const qint64 chunkBytes = qMax(4096, options.chunkBytes);
+
+    const char* p = nullptr;
+    qint64 n = 0;
+    src.next(chunkBytes * threads, &p, &n);
+
+    // Header: skip a UTF-8 BOM, then map column names to positions.
+    if (n >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) { p += 3; n -= 3; }
+    Layout layout;
+    std::fill(layout.at, layout.at + ColumnCount, -1);
+    int line = 1;
+    {
+        RecordReader in(p, p + n);
+        QVector<Field> fields;
+        int spanned = 0;
+        if (in.atEnd() || !in.next(fields, &spanned)) {
+            if (error) *error = "Missing or malformed header row.";
+            return false;
+        }
+        for (int i = 0; i < fields.size(); ++i) {
+            const QString name = QString::fromUtf8(in.data(fields.at(i)), fields.at(i).n).trimmed().toLower();
+            for (int c = 0; c < ColumnCount; ++c)
+                if (name == kColumnNames[c] && layout.at[c] < 0) {
+                    layout.at[c] = i;
+                    layout.width = qMax(layout.width, i + 1);
+                }
+        }
+        if (layout.at[ColType] < 0 || layout.at[ColTitle] < 0) {
+            if (error) *error = "The header needs at least 'type' and 'title' columns.";
+            return false;
+        }
+        line += spanned;
+        n -= in.pos() - p;
+        p = in.pos();
+    }
+
+    int nextId = 1;
+    for (const auto& it : cat.items) nextId = qMax(nextId, it.id + 1);
+
+    QVector<Chunk> chunks;
+    while (n > 0) {
+        // Cut the window into one chunk per thread, on record boundaries.
+        chunks.clear();
+        const qint64 share = qMax<qint64>(4096, n / threads);
+        for (const char* at = p; at < p + n; ) {
+            Chunk c;
+            c.p = at;
+            c.n = cutAfter(at, p + n, share, true);
+            chunks.append(c);
+            at += c.n;
+        }
+
+        Chunk* work = chunks.data();
+        std::vector<std::thread> pool;
+        for (int i = 1; i < chunks.size(); ++i)
+            pool.emplace_back(parseChunk, work + i, std::cref(layout));
+        parseChunk(work, layout);
+        for (auto& t : pool) t.join();
+
+        // Single ordered merge: ids and duplicates are decided in file order.
+        for (Chunk& c : chunks) {
+            for (Row& row : c.rows) {
+                QString why = row.error;
+                if (why.isEmpty()) {
+                    Item& it = row.item;
+                    if (!row.hasId) it.id = nextId;
+                    if (cat.addItem(it)) {
+                        ++rep.imported;
+                        nextId = qMax(nextId, it.id + 1);
+                        continue;
+                    }
+                    why = QString("duplicate id %1").arg(it.id);
+                }
+                ++rep.rejected;
+                if (rep.errors.size() < options.maxErrors)
+                    rep.errors << QString("line %1: %2").arg(line + row.line).arg(why);
+            }
+            line += c.lines;
+        }
+        src.next(chunkBytes * threads, &p, &n);
+    }
+    return true;
+}
+
+bool CatalogueCsv::exportFile(const Catalogue& cat, const QString& path, QString* error) {
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (error) *error = "Could not write " + path + ": " + f.errorString();
+        return false;
+    }
+
+    QByteArray buf;
+    buf.reserve(1 << 20);
+    for (int c = 0; c < ColumnCount; ++c) {
+        if (c) buf += ',';
+        buf += kColumnNames[c];
+    }
+    buf += '\n';
+
+    bool ok = true;
+    for (const auto& it : cat.items) {
+        buf += QByteArray::number(it.id);
+        buf += ',';  putField(buf, toString(it.type));
+        buf += ',';  putField(buf, it.title);
+        buf += ',';  putField(buf, it.creator);
+        buf += ',';  putField(buf, it.dewey);
+        buf += ',';  putField(buf, it.issue);
+        buf += ',';  putDate(buf, it.pub);
+        buf += ',';  putField(buf, it.genre);
+        buf += ',';  putField(buf, it.rating);
+        buf += '\n';
+        if (buf.size() >= (1 << 20)) {
+            ok = ok && f.write(buf) == buf.size();
+            buf.resize(0);   // keeps the reserved capacity
+        }
+    }
+    ok = ok && f.write(buf) == buf.size();
+    if (!ok || !f.commit()) {
+        if (error) *error = "Could not write " + path + ": " + f.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef CATALOGUECSV_H
+#define CATALOGUECSV_H
+
+#include <QString>
+#include <QStringList>
+
+class Catalogue;
+
+// What an import did. Rejected rows are skipped; the first few reasons are
+// kept as "line N: ..." messages.
+struct ImportReport {
+    int imported = 0;
+    int rejected = 0;
+    QStringList errors;
+};
+
+struct ImportOptions {
+    int threads = 0;                  // parser threads; 0 = one per core
+    int chunkBytes = 4 << 20;         // bytes handed to one parser at a time
+    int maxErrors = 100;              // messages kept in ImportReport::errors
+};
+
+// Bulk holdings in RFC 4180 CSV (UTF-8), one item per row:
+//
+//   id,type,title,creator,dewey,issue,pub,genre,rating
+//
+// The header row is required; columns are matched by name, in any order,
+// and unknown ones are ignored. type and title are required per row. An
+// empty id is assigned the next free one. pub is yyyy-MM-dd. Circulation
+// state (loans, holds) is not part of the format; the snapshot keeps that.
+class CatalogueCsv {
+public:
+    // Streams the file (memory-mapped where possible) in chunks that are
+    // parsed in parallel, then added to cat in file order. Memory stays
+    // around threads x chunkBytes whatever the file size. Returns false only
+    // if the file can't be read or its header is unusable.
+    static bool importFile(Catalogue& cat, const QString& path, ImportReport* report = nullptr,
+                           QString* error = nullptr, const ImportOptions& options = ImportOptions());
+
+    // Writes every item, in catalogue order, in the format above.
+    static bool exportFile(const Catalogue& cat, const QString& path, QString* error = nullptr);
+};
+
+#endif // CATALOGUECSV_H
@@ -0,0 +1,117 @@
+#include "cataloguesnapshot.h"
+#include <QMutexLocker>
+
+const Item* CatalogueSnapshot::findItem(int id) const {
+    const int slot = itemSlot_.value(id, -1);
+    return slot >= 0 ? &items_.at(slot) : nullptr;
+}
+
+const User* CatalogueSnapshot::findUserById(int id) const {
+    const int slot = userSlot_.value(id, -1);
+    return slot >= 0 ? &users_.at(slot) : nullptr;
+}
+
+static QList<int> copyOf(const QList<int>& ids) {
+    QList<int> out;
+    out.reserve(ids.size());
+    for (int id : ids) out.append(id);
+    return out;
+}
+
+static Item unshared(const Item& it) {
+    Item out = it;
+    out.holdQueue = it.holdQueue.copy();
+    return out;
+}
+
+static User unshared(const User& u) {
+    User out = u;
+    out.loans = copyOf(u.loans);
+    out.holds = copyOf(u.holds);
+    return out;
+}
+
+// Match `id`'s membership of `from`; additions go at the end, as link() does.
+static void follow(QList<int>& ids, const QList<int>& from, int id) {
+    const bool listed = from.contains(id);
+    if (listed == ids.contains(id)) return;
+    if (listed) ids.append(id);
+    else        ids.removeAll(id);
+}
+
+CatalogueVersions::CatalogueVersions() : edit_(1) {}
+
+CatalogueSnapshot CatalogueVersions::snapshot() const {
+    QMutexLocker locker(&lock_);
+    shared_ = true;
+    return draft_;
+}
+
+// Once a snapshot has the draft's nodes, they are frozen: move to a new
+// edit tag so this write copies instead of changing them under a reader.
+void CatalogueVersions::beginWrite() {
+    if (shared_) {
+        ++edit_;
+        shared_ = false;
+    }
+    ++draft_.version_;
+}
+
+void CatalogueVersions::rebuild(const QList<Item>& items, const QList<User>& users) {
+    QMutexLocker locker(&lock_);
+    beginWrite();
+    draft_.items_.clear();
+    draft_.users_.clear();
+    draft_.itemSlot_.clear();
+    draft_.userSlot_.clear();
+    draft_.itemSlot_.reserve(items.size());
+    draft_.userSlot_.reserve(users.size());
+    // Slot for slot with the catalogue, duplicates and all.
+    for (const auto& it : items) {
+        draft_.itemSlot_.insert(it.id, draft_.items_.size());
+        draft_.items_.append(unshared(it), edit_);
+    }
+    for (const auto& u : users) {
+        draft_.userSlot_.insert(u.id, draft_.users_.size());
+        draft_.users_.append(unshared(u), edit_);
+    }
+}
+
+void CatalogueVersions::appendItem(const Item& it) {
+    QMutexLocker locker(&lock_);
+    beginWrite();
+    draft_.itemSlot_.insert(it.id, draft_.items_.size());
+    draft_.items_.append(unshared(it), edit_);
+}
+
+void CatalogueVersions::appendUser(const User& u) {
+    QMutexLocker locker(&lock_);
+    beginWrite();
+    draft_.userSlot_.insert(u.id, draft_.users_.size());
+    draft_.users_.append(unshared(u), edit_);
+}
+
+void CatalogueVersions::update(int itemSlot, const Item& it, int userSlot, const User* u) {
+    QMutexLocker locker(&lock_);
+    beginWrite();
+    if (itemSlot >= 0 && itemSlot < draft_.items_.size()) draft_.items_.set(itemSlot, unshared(it), edit_);
+    if (u && userSlot >= 0 && userSlot < draft_.users_.size()) draft_.users_.set(userSlot, unshared(*u), edit_);
+}
+
+void CatalogueVersions::circulation(int itemSlot, const Item& it, int userSlot, const User* u) {
+    QMutexLocker locker(&lock_);
+    beginWrite();
+    if (itemSlot >= 0 && itemSlot < draft_.items_.size()) {
+        Item& d = draft_.items_.edited(itemSlot, edit_);
+        d.status     = it.status;
+        d.borrowerId = it.borrowerId;
+        d.due        = it.due;
+        d.pickupBy   = it.pickupBy;
+        if (u) d.holdQueue.follow(it.holdQueue, u->id);
+    }
+    if (u && userSlot >= 0 && userSlot < draft_.users_.size()) {
+        User& d = draft_.users_.edited(userSlot, edit_);
+        follow(d.loans, u->loans, it.id);
+        follow(d.holds, u->holds, it.id);
+    }
+}
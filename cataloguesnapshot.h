@@ -0,0 +1,76 @@
+#ifndef CATALOGUESNAPSHOT_H
+#define CATALOGUESNAPSHOT_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include "item.h"
+#include "user.h"
+#include "persistentvector.h"
+
+// Immutable view of every item and user as of one moment (see
+// Catalogue::snapshot()). Taking one is O(1); it stays valid, unchanged and
+// safe to read from any thread however the catalogue moves on, so long scans
+// and reports need no lock. References into it live as long as it does.
+class CatalogueSnapshot {
+public:
+    int itemCount() const { return items_.size(); }
+    int userCount() const { return users_.size(); }
+
+    // In catalogue order, like Catalogue::items/users.
+    const Item& itemAt(int slot) const { return items_.at(slot); }
+    const User& userAt(int slot) const { return users_.at(slot); }
+
+    const Item* findItem(int id) const;
+    const User* findUserById(int id) const;
+
+    // Bumped by every change the catalogue publishes; equal versions mean
+    // equal contents.
+    quint64 version() const { return version_; }
+
+private:
+    friend class CatalogueVersions;
+    PersistentVector<Item> items_;
+    PersistentVector<User> users_;
+    QHash<int, int> itemSlot_;    // id -> slot, shared with the writer until it adds
+    QHash<int, int> userSlot_;
+    quint64 version_ = 0;
+};
+
+// The catalogue's side of snapshots: a copy-on-write mirror of items and
+// users that Catalogue updates as it changes. Writes go into a draft that is
+// edited in place until a snapshot is taken; the next write after that copies
+// only the trie path it touches, so writers never wait on readers and
+// readers never see half a command.
+class CatalogueVersions {
+public:
+    CatalogueVersions();
+
+    CatalogueSnapshot snapshot() const;
+
+    // The mirror never shares a hold queue or loan/hold list with the
+    // catalogue: if it did, the catalogue's next change to one would copy it
+    // whole. These copy them once; circulation() then follows them.
+    void rebuild(const QList<Item>& items, const QList<User>& users);
+    void appendItem(const Item& it);
+    void appendUser(const User& u);
+    // An edit: the item and, if userSlot >= 0, its user, published together.
+    void update(int itemSlot, const Item& it, int userSlot = -1, const User* u = nullptr);
+    // A circulation change (see Catalogue::touchCirculation): status, dates
+    // and borrower are copied; of the hold queue and u's lists, only it's
+    // queue membership of u and u's of it can have changed, and only that is
+    // replayed, so a command costs O(log n) in the queue, not O(n).
+    void circulation(int itemSlot, const Item& it, int userSlot = -1, const User* u = nullptr);
+
+private:
+    Q_DISABLE_COPY(CatalogueVersions)
+
+    mutable QMutex lock_;
+    mutable quint64 edit_;        // tag the draft's own nodes carry
+    mutable bool shared_ = false; // a snapshot holds the draft's nodes
+    CatalogueSnapshot draft_;
+
+    void beginWrite();
+};
+
+#endif // CATALOGUESNAPSHOT_H
@@ -0,0 +1,315 @@
+#include "cataloguestore.h"
+#include "catalogue.h"
+#include "librarycontroller.h"
+#include "itempolicy.h"
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QHash>
+#include <QtEndian>
+#include <limits>
+
+// Snapshot layout (little-endian), version 2:
+//   header : u32 magic | u16 version | u16 reserved | u64 lastSeq
+//            | u32 strings | u32 items | u32 users
+//   strings: u32 len | len x u16 (UTF-16) | pad to 4 bytes
+//   items  : i32 id | u8 type | u8 status | i32 borrower | i64 due | i64 pub
+//            | i64 pickupBy (not in version 1) | u32 title, creator, dewey, issue, genre, rating (string refs)
+//            | u32 n | n x i32 hold queue
+//   users  : i32 id | u8 type | u32 name | u32 n | n x i32 loans | u32 n | n x i32 holds
+static const quint32 kSnapMagic   = 0x4E534C48;   // "HLSN"
+static const quint16 kSnapVersion = 2;   // 1 still loads
+// Fewest bytes each record can take, to check header counts against the file.
+static const qint64  kMinString   = 4;
+static const qint64  kMinItem     = 4 + 1 + 1 + 4 + 8 + 8 + 6 * 4 + 4;
+static const qint64  kMinUser     = 4 + 1 + 4 + 4 + 4;
+static const qint64  kNoDay       = std::numeric_limits<qint64>::min();
+
+static qint64 dayOf(const QDate& d) { return d.isValid() ? d.toJulianDay() : kNoDay; }
+static QDate dateOf(qint64 jd) { return jd == kNoDay ? QDate() : QDate::fromJulianDay(jd); }
+
+namespace {
+
+class Writer {
+public:
+    QByteArray buf;
+    template <typename T> void put(T v) {
+        const int at = buf.size();
+        buf.resize(at + int(sizeof(T)));
+        qToLittleEndian<T>(v, buf.data() + at);
+    }
+    void ids(const QList<int>& list) {
+        put<quint32>(quint32(list.size()));
+        for (int v : list) put<qint32>(v);
+    }
+};
+
+class Reader {
+public:
+    Reader(const uchar* p, qint64 n) : p_(p), end_(p + n) {}
+    bool ok() const { return ok_; }
+    qint64 remaining() const { return end_ - p_; }
+    template <typename T> T get() {
+        if (end_ - p_ < qint64(sizeof(T))) { ok_ = false; p_ = end_; return T(0); }
+        const T v = qFromLittleEndian<T>(p_);
+        p_ += sizeof(T);
+        return v;
+    }
+    const uchar* take(qint64 n) {
+        if (n < 0 || end_ - p_ < n) { ok_ = false; p_ = end_; return nullptr; }
+        const uchar* at = p_;
+        p_ += n;
+        return at;
+    }
+    QList<int> ids() {
+        const quint32 n = get<quint32>();
+        QList<int> out;
+        if (!ok_ || qint64(n) * 4 > end_ - p_) { ok_ = false; return out; }
+        out.reserve(int(n));
+        for (quint32 i = 0; i < n; ++i) out.append(get<qint32>());
+        return out;
+    }
+private:
+    const uchar* p_;
+    const uchar* end_;
+    bool ok_ = true;
+};
+
+} // namespace
+
+CatalogueStore::CatalogueStore(const QString& dir) : dir_(dir) {}
+
+QString CatalogueStore::snapshotPath() const { return QDir(dir_).filePath("catalogue.snap"); }
+QString CatalogueStore::journalPath()  const { return QDir(dir_).filePath("catalogue.journal"); }
+
+bool CatalogueStore::saveSnapshot(const Catalogue& cat, const QString& path, quint64 lastSeq, QString* error) {
+    // Text is heavily repetitive (creators, genres, ratings), so store each
+    // distinct string once and refer to it by index.
+    QList<QString> strings;
+    QHash<QString, quint32> refs;
+    auto ref = [&](const QString& s) -> quint32 {
+        auto found = refs.constFind(s);
+        if (found != refs.constEnd()) return found.value();
+        const quint32 r = quint32(strings.size());
+        strings.append(s);
+        refs.insert(s, r);
+        return r;
+    };
+
+    Writer body;
+    for (const auto& it : cat.items) {
+        body.put<qint32>(it.id);
+        body.put<quint8>(quint8(it.type));
+        body.put<quint8>(quint8(it.status));
+        body.put<qint32>(it.borrowerId);
+        body.put<qint64>(dayOf(it.due));
+        body.put<qint64>(dayOf(it.pub));
+        body.put<qint64>(dayOf(it.pickupBy));
+        body.put<quint32>(ref(it.title));
+        body.put<quint32>(ref(it.creator));
+        body.put<quint32>(ref(it.dewey));
+        body.put<quint32>(ref(it.issue));
+        body.put<quint32>(ref(it.genre));
+        body.put<quint32>(ref(it.rating));
+        body.ids(it.holdQueue.toList());
+    }
+    for (const auto& u : cat.users) {
+        body.put<qint32>(u.id);
+        body.put<quint8>(quint8(u.type));
+        body.put<quint32>(ref(u.name));
+        body.ids(u.loans);
+        body.ids(u.holds);
+    }
+
+    Writer head;
+    head.put<quint32>(kSnapMagic);
+    head.put<quint16>(kSnapVersion);
+    head.put<quint16>(0);
+    head.put<quint64>(lastSeq);
+    head.put<quint32>(quint32(strings.size()));
+    head.put<quint32>(quint32(cat.items.size()));
+    head.put<quint32>(quint32(cat.users.size()));
+    for (const auto& s : strings) {
+        head.put<quint32>(quint32(s.size()));
+        for (QChar c : s) head.put<quint16>(c.unicode());
+        if (s.size() & 1) head.put<quint16>(0);
+    }
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+    f.write(head.buf);
+    f.write(body.buf);
+    if (!syncToDisk(f) || !f.commit()) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool CatalogueStore::loadSnapshot(Catalogue& cat, const QString& path, quint64* lastSeq, QString* error) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+    const qint64 size = f.size();
+    uchar* map = f.map(0, size);
+    QByteArray fallback;
+    if (!map) {                       // e.g. filesystems without mmap
+        fallback = f.readAll();
+        map = reinterpret_cast<uchar*>(fallback.data());
+    }
+
+    Reader in(map, size);
+    const quint32 magic = in.get<quint32>();
+    const quint16 version = in.get<quint16>();
+    if (magic != kSnapMagic || version < 1 || version > kSnapVersion) {
+        if (error) *error = "Not a catalogue snapshot, or an unsupported version.";
+        return false;
+    }
+    in.get<quint16>();
+    const quint64 seq   = in.get<quint64>();
+    const quint32 nStr  = in.get<quint32>();
+    const quint32 nItem = in.get<quint32>();
+    const quint32 nUser = in.get<quint32>();
+
+    // Counts come from the file: a damaged one mustn't make us reserve
+    // gigabytes, or overflow int, before the reads below notice.
+    const quint32 maxCount = quint32(std::numeric_limits<int>::max());
+    if (!in.ok() || nStr > maxCount || nItem > maxCount || nUser > maxCount
+            || qint64(nStr) * kMinString + qint64(nItem) * kMinItem + qint64(nUser) * kMinUser > in.remaining()) {
+        if (error) *error = "Snapshot is truncated or corrupt.";
+        return false;
+    }
+
+    QList<QString> strings;
+    strings.reserve(int(nStr));
+    for (quint32 i = 0; i < nStr && in.ok(); ++i) {
+        const quint32 len = in.get<quint32>();
+        const uchar* chars = in.take(qint64(len + (len & 1)) * 2);
+        if (!chars) break;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        strings.append(QString(reinterpret_cast<const QChar*>(chars), int(len)));
+#else
+        QString s(int(len), Qt::Uninitialized);
+        for (quint32 c = 0; c < len; ++c) s[int(c)] = QChar(qFromLittleEndian<quint16>(chars + 2 * c));
+        strings.append(s);
+#endif
+    }
+    auto str = [&](quint32 r) { return r < quint32(strings.size()) ? strings.at(int(r)) : QString(); };
+
+    // Enum bytes index per-type tables and facet bitmaps once reindexed, so
+    // one out of range fails the load like a short read does.
+    bool badEnum = false;
+    QList<Item> items;
+    items.reserve(int(nItem));
+    for (quint32 i = 0; i < nItem && in.ok() && !badEnum; ++i) {
+        Item it;
+        it.id = in.get<qint32>();
+        const quint8 type = in.get<quint8>(), status = in.get<quint8>();
+        if (type >= kItemTypeCount || status > quint8(Availability::CheckedOut)) badEnum = true;
+        it.type       = ItemType(type);
+        it.status     = Availability(status);
+        it.borrowerId = in.get<qint32>();
+        it.due        = dateOf(in.get<qint64>());
+        it.pub        = dateOf(in.get<qint64>());
+        if (version >= 2) it.pickupBy = dateOf(in.get<qint64>());
+        it.title      = str(in.get<quint32>());
+        it.creator    = str(in.get<quint32>());
+        it.dewey      = str(in.get<quint32>());
+        it.issue      = str(in.get<quint32>());
+        it.genre      = str(in.get<quint32>());
+        it.rating     = str(in.get<quint32>());
+        it.holdQueue  = HoldQueue::fromList(in.ids());
+        items.append(it);
+    }
+
+    QList<User> users;
+    users.reserve(int(nUser));
+    for (quint32 i = 0; i < nUser && in.ok() && !badEnum; ++i) {
+        User u;
+        u.id    = in.get<qint32>();
+        const quint8 type = in.get<quint8>();
+        if (type > quint8(UserType::Admin)) badEnum = true;
+        u.type  = UserType(type);
+        u.name  = str(in.get<quint32>());
+        u.loans = in.ids();
+        u.holds = in.ids();
+        users.append(u);
+    }
+
+    if (!in.ok() || badEnum) {
+        if (error) *error = "Snapshot is truncated or corrupt.";
+        return false;
+    }
+
+    // Swap rather than assign: reindex() writes to the items, and a list still
+    // shared with the locals here would be deep-copied first.
+    cat.items.swap(items);
+    cat.users.swap(users);
+    cat.reindex();
+    if (lastSeq) *lastSeq = seq;
+    return true;
+}
+
+bool CatalogueStore::exists() const {
+    return QFile::exists(snapshotPath());
+}
+
+bool CatalogueStore::open(Catalogue& cat, LibraryController& lib) {
+    if (!exists()) {
+        error_ = "No stored catalogue.";
+        return false;
+    }
+    quint64 lastSeq = 0;
+    if (!loadSnapshot(cat, snapshotPath(), &lastSeq, &error_)) return false;
+
+    QList<Journal::Record> records;
+    if (!journal_.open(journalPath(), &records)) {
+        error_ = "Could not open the journal " + journalPath() + ".";
+        return false;
+    }
+    journal_.setLastSeq(lastSeq);
+
+    // Records up to lastSeq are already in the snapshot (a crash can land
+    // between writing the snapshot and truncating the journal).
+    for (const auto& r : records) {
+        if (r.seq <= lastSeq) continue;
+        switch (r.op) {
+            case Journal::Borrow:
+                if (lib.borrow(r.userId, r.itemId).ok) {
+                    if (Item* it = cat.findItem(r.itemId)) { it->due = r.due; cat.touchCirculation(it->id); }
+                }
+                break;
+            case Journal::Return:
+            case Journal::CancelHold: {
+                const bool ok = r.op == Journal::Return ? lib.returnItem(r.userId, r.itemId).ok
+                                                        : lib.cancelHold(r.userId, r.itemId).ok;
+                // The pickup window started when it was recorded, not today.
+                Item* it = ok && r.due.isValid() ? cat.findItem(r.itemId) : nullptr;
+                if (it) { it->pickupBy = r.due; cat.touchCirculation(it->id); }
+                break;
+            }
+            case Journal::PlaceHold:  lib.placeHold(r.userId, r.itemId);  break;
+        }
+    }
+    lib.rescheduleAll();   // replay patched due and pickup dates behind the controller's back
+    return true;
+}
+
+bool CatalogueStore::checkpoint(const Catalogue& cat) {
+    if (!QDir().mkpath(dir_)) {
+        error_ = "Could not create " + dir_;
+        return false;
+    }
+    if (!journal_.isOpen() && !journal_.open(journalPath())) {
+        error_ = "Could not open the journal.";
+        return false;
+    }
+    journal_.commit();
+    if (!saveSnapshot(cat, snapshotPath(), journal_.lastSeq(), &error_)) return false;
+    return journal_.truncate();
+}
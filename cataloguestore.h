@@ -0,0 +1,45 @@
+#ifndef CATALOGUESTORE_H
+#define CATALOGUESTORE_H
+
+#include <QString>
+#include "journal.h"
+
+class Catalogue;
+class LibraryController;
+
+// On-disk home of the catalogue: a versioned binary snapshot plus the
+// journal of commands applied since that snapshot was taken.
+class CatalogueStore {
+public:
+    explicit CatalogueStore(const QString& dir);
+
+    // Whether a snapshot has been written here. When it has, a failing open()
+    // means the stored state is unreadable, not missing: callers must not
+    // seed and checkpoint over it.
+    bool exists() const;
+
+    // Loads the snapshot (memory-mapped) into cat and replays the journal
+    // tail through lib. Returns false when there is no stored state yet, or
+    // it can't be read (see lastError()); the files are left as they are.
+    bool open(Catalogue& cat, LibraryController& lib);
+
+    // Writes a fresh snapshot atomically, then empties the journal.
+    bool checkpoint(const Catalogue& cat);
+
+    Journal* journal() { return &journal_; }
+    QString  lastError() const { return error_; }
+    QString  directory() const { return dir_; }
+
+    static bool saveSnapshot(const Catalogue& cat, const QString& path, quint64 lastSeq, QString* error = nullptr);
+    static bool loadSnapshot(Catalogue& cat, const QString& path, quint64* lastSeq, QString* error = nullptr);
+
+private:
+    QString snapshotPath() const;
+    QString journalPath() const;
+
+    QString dir_;
+    QString error_;
+    Journal journal_;
+};
+
+#endif // CATALOGUESTORE_H
@@ -0,0 +1,34 @@
+#include "changebus.h"
+#include "librarycontroller.h"
+#include <QMetaObject>
+#include <QMutexLocker>
+
+ChangeBus::ChangeBus(QObject* parent) : QObject(parent) {}
+
+void ChangeBus::attach(LibraryController* lib) {
+    lib->subscribe([this](const ChangeSet& changes){ post(changes); });
+}
+
+void ChangeBus::post(const ChangeSet& changes) {
+    if (changes.isEmpty()) return;
+    QMutexLocker locker(&lock_);
+    pending_.merge(changes);
+    if (queued_) return;
+    queued_ = true;
+    QMetaObject::invokeMethod(this, [this]{ flush(); }, Qt::QueuedConnection);
+}
+
+void ChangeBus::flush() {
+    ChangeSet changes;
+    {
+        QMutexLocker locker(&lock_);
+        std::swap(changes, pending_);
+        queued_ = false;
+    }
+    changes.normalize();
+    emit changed(changes);
+    if (!changes.items.isEmpty()) emit itemsChanged(changes.items);
+    if (!changes.loanUsers.isEmpty()) emit loansChanged(changes.loanUsers);
+    if (!changes.holdItems.isEmpty() || !changes.holdUsers.isEmpty())
+        emit holdQueuesChanged(changes.holdItems, changes.holdUsers);
+}
@@ -0,0 +1,37 @@
+#ifndef CHANGEBUS_H
+#define CHANGEBUS_H
+
+#include <QObject>
+#include <QMutex>
+#include "changeset.h"
+
+class LibraryController;
+
+// Coalesces controller change sets and re-emits them once per event-loop
+// pass: a burst of commands, or a batch of 500 returns, reaches the views as
+// one incremental update. post() is thread-safe; the signals are emitted on
+// the bus's thread with sorted, de-duplicated ids.
+class ChangeBus : public QObject {
+    Q_OBJECT
+public:
+    explicit ChangeBus(QObject* parent = nullptr);
+
+    // Subscribes post() to the controller's change notices.
+    void attach(LibraryController* lib);
+    void post(const ChangeSet& changes);
+
+signals:
+    void changed(const ChangeSet& changes);   // everything, for one-pass consumers
+    void itemsChanged(const QVector<int>& itemIds);
+    void loansChanged(const QVector<int>& userIds);
+    void holdQueuesChanged(const QVector<int>& itemIds, const QVector<int>& userIds);
+
+private:
+    void flush();
+
+    QMutex lock_;
+    ChangeSet pending_;
+    bool queued_ = false;
+};
+
+#endif // CHANGEBUS_H
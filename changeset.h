@@ -0,0 +1,45 @@
+#ifndef CHANGESET_H
+#define CHANGESET_H
+
+#include <QVector>
+#include <algorithm>
+
+// What one or more commands changed, by kind, as ids. Subscribers use it to
+// update only what is affected instead of re-reading the whole catalogue.
+struct ChangeSet {
+    QVector<int> items;       // ItemChanged: status, borrower or due date
+    QVector<int> loanUsers;   // LoanChanged: users whose loans changed
+    QVector<int> holdItems;   // HoldQueueChanged: items whose queue changed...
+    QVector<int> holdUsers;   // ...and the users who joined or left one
+
+    bool isEmpty() const {
+        return items.isEmpty() && loanUsers.isEmpty() && holdItems.isEmpty() && holdUsers.isEmpty();
+    }
+
+    void merge(const ChangeSet& o) {
+        items += o.items;
+        loanUsers += o.loanUsers;
+        holdItems += o.holdItems;
+        holdUsers += o.holdUsers;
+    }
+
+    // Sort and de-duplicate every list, so readers can binary-search them.
+    void normalize() {
+        sortUnique(items);
+        sortUnique(loanUsers);
+        sortUnique(holdItems);
+        sortUnique(holdUsers);
+    }
+
+    static bool has(const QVector<int>& ids, int id) {
+        return std::binary_search(ids.begin(), ids.end(), id);
+    }
+
+private:
+    static void sortUnique(QVector<int>& v) {
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+    }
+};
+
+#endif // CHANGESET_H
@@ -0,0 +1,34 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QDate>
+
+// Source of "today" for circulation rules (due dates, overdue checks, hold
+// pickup windows). Day granularity is all the library needs.
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual QDate today() const = 0;
+};
+
+// The wall clock.
+class SystemClock : public Clock {
+public:
+    QDate today() const override { return QDate::currentDate(); }
+    static const SystemClock* instance() { static const SystemClock c; return &c; }
+};
+
+// A clock that only moves when told to, so tests and benchmarks can
+// fast-forward days. Drive it from one thread.
+class SimulatedClock : public Clock {
+public:
+    explicit SimulatedClock(const QDate& start = QDate::currentDate()) : today_(start) {}
+    QDate today() const override { return today_; }
+    void setToday(const QDate& d) { today_ = d; }
+    void advance(int days) { today_ = today_.addDays(days); }
+
+private:
+    QDate today_;
+};
+
+#endif // CLOCK_H
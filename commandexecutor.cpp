@@ -0,0 +1,89 @@
+#include "commandexecutor.h"
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QThread>
+
+CommandExecutor::CommandExecutor(LibraryController* lib, int threads)
+    : lib_(lib)
+{
+    const int n = !lib->concurrent() ? 1 : qMax(1, threads > 0 ? threads : QThread::idealThreadCount());
+    for (int w = 0; w < n; ++w) workers_.emplace_back(&CommandExecutor::work, this);
+}
+
+CommandExecutor::~CommandExecutor() {
+    {
+        QMutexLocker locker(&lock_);
+        stopping_ = true;
+        wake_.wakeAll();
+    }
+    for (auto& t : workers_) t.join();
+}
+
+quint64 CommandExecutor::submit(Command cmd, const Completion& done) {
+    QMutexLocker locker(&lock_);
+    cmd.ticket = nextTicket_++;
+    ++pending_;
+    QQueue<Entry>& lane = lanes_[cmd.itemId];
+    const bool idle = lane.isEmpty();
+    lane.enqueue(Entry{cmd, done});
+    if (idle) {
+        ready_.enqueue(cmd.itemId);
+        wake_.wakeOne();
+    }
+    return cmd.ticket;
+}
+
+int CommandExecutor::pending() const {
+    QMutexLocker locker(&lock_);
+    return pending_;
+}
+
+void CommandExecutor::drain() {
+    QMutexLocker locker(&lock_);
+    while (pending_ > 0) idle_.wait(&lock_);
+}
+
+Result CommandExecutor::execute(const Command& cmd) {
+    switch (cmd.kind) {
+        case Command::Borrow:     return lib_->borrow(cmd.userId, cmd.itemId);
+        case Command::Return:     return lib_->returnItem(cmd.userId, cmd.itemId);
+        case Command::PlaceHold:  return lib_->placeHold(cmd.userId, cmd.itemId);
+        case Command::CancelHold: return lib_->cancelHold(cmd.userId, cmd.itemId);
+        case Command::DueEvents:  return Result(true, QString(), lib_->runDueEvents().size());
+    }
+    return Result(false, "Unknown command.");
+}
+
+// An item is in ready_ at most once and leaves its lane only after its
+// completion ran, which is what keeps one item's commands in order.
+void CommandExecutor::work() {
+    for (;;) {
+        int itemId;
+        Entry e;
+        {
+            QMutexLocker locker(&lock_);
+            while (ready_.isEmpty() && !stopping_) wake_.wait(&lock_);
+            if (ready_.isEmpty()) return;    // stopping, and everything queued has run
+            itemId = ready_.dequeue();
+            e = lanes_[itemId].head();
+        }
+
+        Result r;
+        {
+            QReadLocker gate(&gate_);
+            r = execute(e.cmd);
+        }
+        if (e.done) e.done(e.cmd, r);
+
+        QMutexLocker locker(&lock_);
+        auto lane = lanes_.find(itemId);
+        lane->dequeue();
+        if (lane->isEmpty()) {
+            lanes_.erase(lane);
+        } else {
+            ready_.enqueue(itemId);
+            wake_.wakeOne();
+        }
+        if (--pending_ == 0) idle_.wakeAll();
+    }
+}
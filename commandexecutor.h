@@ -0,0 +1,89 @@
+#ifndef COMMANDEXECUTOR_H
+#define COMMANDEXECUTOR_H
+
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QReadWriteLock>
+#include <QWaitCondition>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "librarycontroller.h"
+
+// One circulation command for CommandExecutor. DueEvents runs
+// LibraryController::runDueEvents() (aux = events fired); it has no user or
+// item, so its runs share the -1 lane and queue behind one another.
+struct Command {
+    enum Kind { Borrow, Return, PlaceHold, CancelHold, DueEvents };
+    Kind kind;
+    int userId;
+    int itemId;
+    quint64 ticket;     // assigned by submit(), increasing
+    Command(Kind k=Borrow, int u=-1, int i=-1) : kind(k), userId(u), itemId(i), ticket(0) {}
+};
+
+// Runs circulation commands on worker threads so the caller never waits on
+// one. Commands on the same item run one at a time, in the order submitted,
+// each after the previous one's completion; commands on different items may
+// run side by side and finish in any order, so a user can pipeline several.
+//
+// With a non-concurrent controller there is one worker, and nothing else may
+// call the controller while commands are queued. Otherwise workers share the
+// controller's stripe locks with any other thread using it.
+class CommandExecutor {
+public:
+    // Called on a worker thread after the command ran and its change notice
+    // went out. GUI code bounces it to its own thread (invokeMethod, queued).
+    typedef std::function<void(const Command& cmd, const Result& r)> Completion;
+
+    explicit CommandExecutor(LibraryController* lib, int threads = 0);   // 0: one per core
+    ~CommandExecutor();   // runs what is queued, then joins
+
+    int threads() const { return int(workers_.size()); }
+
+    quint64 submit(Command cmd, const Completion& done = Completion());
+    int  pending() const;   // submitted and not yet completed
+    void drain();           // waits until pending() == 0; not while paused
+
+    // Code that walks the live catalogue outside the controller (imports,
+    // exports) holds a Pause for the duration; readers that can use a
+    // Catalogue::snapshot() (the item table, account views) need none. It waits for commands
+    // already running and keeps new ones from starting. Pauses nest on one
+    // thread; a null executor makes it a no-op.
+    class Pause {
+    public:
+        explicit Pause(CommandExecutor* ex) : lock_(ex ? &ex->gate_ : nullptr) { if (lock_) lock_->lockForWrite(); }
+        ~Pause() { if (lock_) lock_->unlock(); }
+    private:
+        Q_DISABLE_COPY(Pause)
+        QReadWriteLock* lock_;
+    };
+
+private:
+    Q_DISABLE_COPY(CommandExecutor)
+
+    struct Entry {
+        Command cmd;
+        Completion done;
+    };
+
+    void work();
+    Result execute(const Command& cmd);
+
+    LibraryController* lib_;
+    QReadWriteLock gate_{QReadWriteLock::Recursive};   // workers read, Pause writes
+
+    mutable QMutex lock_;
+    QWaitCondition wake_;
+    QWaitCondition idle_;
+    QHash<int, QQueue<Entry>> lanes_;   // item id -> its commands; the head is next or running
+    QQueue<int> ready_;                 // items whose head may start
+    quint64 nextTicket_ = 1;
+    int pending_ = 0;
+    bool stopping_ = false;
+
+    std::vector<std::thread> workers_;
+};
+
+#endif // COMMANDEXECUTOR_H
@@ -0,0 +1,66 @@
+# GUI-free core: catalogue, circulation rules, indexes and persistence.
+# Included by the desktop app, the headless server and the tools.
+
+# CONFIG += no_metrics compiles the HL_TIMED/HL_COUNT probes out (see metrics.h).
+no_metrics: DEFINES += HINLIBS_NO_METRICS
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+SOURCES += \
+    $$PWD/accountview.cpp \
+    $$PWD/availabilityforecast.cpp \
+    $$PWD/catalogue.cpp \
+    $$PWD/cataloguecsv.cpp \
+    $$PWD/cataloguesnapshot.cpp \
+    $$PWD/cataloguestore.cpp \
+    $$PWD/changebus.cpp \
+    $$PWD/commandexecutor.cpp \
+    $$PWD/deweyindex.cpp \
+    $$PWD/duescheduler.cpp \
+    $$PWD/facetindex.cpp \
+    $$PWD/holdqueue.cpp \
+    $$PWD/item.cpp \
+    $$PWD/itemcolumns.cpp \
+    $$PWD/itempolicy.cpp \
+    $$PWD/journal.cpp \
+    $$PWD/librarycontroller.cpp \
+    $$PWD/metrics.cpp \
+    $$PWD/nameindex.cpp \
+    $$PWD/relationstore.cpp \
+    $$PWD/reportengine.cpp \
+    $$PWD/rowbitmap.cpp \
+    $$PWD/searchindex.cpp \
+    $$PWD/texttable.cpp \
+    $$PWD/user.cpp
+
+HEADERS += \
+    $$PWD/accountview.h \
+    $$PWD/availabilityforecast.h \
+    $$PWD/catalogue.h \
+    $$PWD/cataloguecsv.h \
+    $$PWD/cataloguesnapshot.h \
+    $$PWD/cataloguestore.h \
+    $$PWD/changebus.h \
+    $$PWD/changeset.h \
+    $$PWD/clock.h \
+    $$PWD/commandexecutor.h \
+    $$PWD/deweyindex.h \
+    $$PWD/duescheduler.h \
+    $$PWD/facetindex.h \
+    $$PWD/holdqueue.h \
+    $$PWD/item.h \
+    $$PWD/itemcolumns.h \
+    $$PWD/itempolicy.h \
+    $$PWD/journal.h \
+    $$PWD/librarycontroller.h \
+    $$PWD/lockstripes.h \
+    $$PWD/metrics.h \
+    $$PWD/nameindex.h \
+    $$PWD/persistentvector.h \
+    $$PWD/relationstore.h \
+    $$PWD/reportengine.h \
+    $$PWD/rowbitmap.h \
+    $$PWD/searchindex.h \
+    $$PWD/texttable.h \
+    $$PWD/user.h
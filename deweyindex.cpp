@@ -0,0 +1,171 @@
+#include "deweyindex.h"
+#include <algorithm>
+#include <limits>
+
+const quint64 DeweyIndex::kNoKey = std::numeric_limits<quint64>::max();
+
+static const int kDecimals = 12;
+static const quint64 kScale = 1000000000000ULL;   // 10^kDecimals
+
+// Class (0..999) and up to kDecimals decimals; missing decimals read as pad.
+static quint64 parseKey(const QString& dewey, int pad) {
+    const QChar* p = dewey.constData();
+    const QChar* end = p + dewey.size();
+    while (p != end && p->isSpace()) ++p;
+
+    quint64 whole = 0;
+    int digits = 0;
+    for (; p != end && p->isDigit(); ++p) {
+        if (++digits > 3) return DeweyIndex::kNoKey;
+        whole = whole * 10 + quint64(p->digitValue());
+    }
+    if (digits == 0) return DeweyIndex::kNoKey;
+
+    quint64 frac = 0;
+    int decimals = 0;
+    if (p != end && *p == QLatin1Char('.')) {
+        for (++p; p != end && p->isDigit(); ++p) {
+            if (decimals == kDecimals) continue;
+            frac = frac * 10 + quint64(p->digitValue());
+            ++decimals;
+        }
+    }
+    for (; decimals < kDecimals; ++decimals) frac = frac * 10 + quint64(pad);
+    return whole * kScale + frac;
+}
+
+quint64 DeweyIndex::keyOf(const QString& dewey)      { return parseKey(dewey, 0); }
+quint64 DeweyIndex::upperKeyOf(const QString& dewey) { return parseKey(dewey, 9); }
+
+void DeweyIndex::clear() {
+    blocks_.clear();
+    keys_.clear();
+}
+
+void DeweyIndex::rebuild(const QList<Item>& items) {
+    clear();
+    QVector<Entry> all;
+    all.reserve(items.size());
+    for (const auto& it : items) {
+        const quint64 key = keyOf(it.dewey);
+        if (key == kNoKey || keys_.contains(it.id)) continue;
+        keys_.insert(it.id, key);
+        all.append(Entry{ key, it.id });
+    }
+    std::sort(all.begin(), all.end());
+
+    // Bulk load half-full blocks, leaving room for later inserts.
+    const int per = kMaxBlock / 2;
+    for (int at = 0; at < all.size(); at += per)
+        blocks_.append(all.mid(at, per));
+}
+
+int DeweyIndex::blockFor(const Entry& e) const {
+    int lo = 0, hi = blocks_.size();
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (blocks_.at(mid).last() < e) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void DeweyIndex::insert(const Entry& e) {
+    if (blocks_.isEmpty()) {
+        blocks_.append(QVector<Entry>{ e });
+        return;
+    }
+    const int b = qMin(blockFor(e), int(blocks_.size()) - 1);
+    QVector<Entry>& block = blocks_[b];
+    block.insert(std::lower_bound(block.begin(), block.end(), e), e);
+    if (block.size() > kMaxBlock) {
+        const int half = block.size() / 2;
+        blocks_.insert(b + 1, block.mid(half));
+        blocks_[b].resize(half);
+    }
+}
+
+void DeweyIndex::erase(const Entry& e) {
+    const int b = blockFor(e);
+    if (b >= blocks_.size()) return;
+    QVector<Entry>& block = blocks_[b];
+    auto at = std::lower_bound(block.begin(), block.end(), e);
+    if (at == block.end() || at->itemId != e.itemId || at->key != e.key) return;
+    block.erase(at);
+    if (block.isEmpty()) blocks_.removeAt(b);
+}
+
+void DeweyIndex::add(const Item& it) {
+    if (keys_.contains(it.id)) remove(it.id);
+    const quint64 key = keyOf(it.dewey);
+    if (key == kNoKey) return;
+    keys_.insert(it.id, key);
+    insert(Entry{ key, it.id });
+}
+
+void DeweyIndex::remove(int itemId) {
+    auto found = keys_.find(itemId);
+    if (found == keys_.end()) return;
+    erase(Entry{ found.value(), itemId });
+    keys_.erase(found);
+}
+
+void DeweyIndex::update(const Item& it) {
+    if (keys_.value(it.id, kNoKey) == keyOf(it.dewey)) return;
+    add(it);
+}
+
+QVector<int> DeweyIndex::range(quint64 low, quint64 high) const {
+    QVector<int> out;
+    if (low > high || low == kNoKey) return out;
+    const Entry first{ low, std::numeric_limits<int>::min() };
+    const int start = blockFor(first);
+    for (int b = start; b < blocks_.size(); ++b) {
+        const QVector<Entry>& block = blocks_.at(b);
+        auto at = b == start ? std::lower_bound(block.begin(), block.end(), first) : block.begin();
+        for (; at != block.end(); ++at) {
+            if (at->key > high) return out;
+            out.append(at->itemId);
+        }
+    }
+    return out;
+}
+
+QVector<int> DeweyIndex::inOrder() const {
+    QVector<int> out;
+    out.reserve(keys_.size());
+    for (const auto& block : blocks_)
+        for (const auto& e : block) out.append(e.itemId);
+    return out;
+}
+
+QVector<int> DeweyIndex::near(int itemId, int radius) const {
+    QVector<int> out;
+    auto found = keys_.constFind(itemId);
+    if (found == keys_.constEnd() || radius <= 0) return out;
+    const Entry self{ found.value(), itemId };
+    const int b = blockFor(self);
+    if (b >= blocks_.size()) return out;
+    const int at = int(std::lower_bound(blocks_.at(b).begin(), blocks_.at(b).end(), self) - blocks_.at(b).begin());
+
+    // Walk left, then right, across block boundaries.
+    QVector<int> before;
+    for (int cb = b, ci = at - 1; before.size() < radius; --ci) {
+        if (ci < 0) {
+            if (--cb < 0) break;
+            ci = blocks_.at(cb).size() - 1;
+        }
+        before.append(blocks_.at(cb).at(ci).itemId);
+    }
+    std::reverse(before.begin(), before.end());
+    out = before;
+    for (int cb = b, ci = at + 1, taken = 0; taken < radius; ++ci) {
+        if (ci >= blocks_.at(cb).size()) {
+            if (++cb >= blocks_.size()) break;
+            ci = 0;
+        }
+        out.append(blocks_.at(cb).at(ci).itemId);
+        ++taken;
+    }
+    return out;
+}
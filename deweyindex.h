@@ -0,0 +1,57 @@
+#ifndef DEWEYINDEX_H
+#define DEWEYINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include "item.h"
+
+// Items with a Dewey class number, in shelf order. Each number is parsed
+// once into a sortable key (class, then decimals compared digit by digit,
+// so 510.46 < 510.9), and entries are kept in sorted blocks of at most
+// kMaxBlock: a two-level B+-tree. Lookups binary-search the blocks and then
+// the block, so a range query is O(log n + k) and inserting out of order
+// only moves one block's tail.
+class DeweyIndex {
+public:
+    static const quint64 kNoKey;   // keyOf() for text that isn't a class number
+
+    // "510.9" -> 510.900000000000 as an integer; text after the number (e.g.
+    // a Cutter "KUM") is ignored. Up to 12 decimals are significant.
+    static quint64 keyOf(const QString& dewey);
+    // The largest key that dewey is a prefix of: "599" covers 599.999...
+    static quint64 upperKeyOf(const QString& dewey);
+
+    void clear();
+    void rebuild(const QList<Item>& items);
+    void add(const Item& it);
+    void remove(int itemId);
+    void update(const Item& it);   // no-op unless the key changed
+    int size() const { return keys_.size(); }
+    // The key parsed when itemId was indexed; kNoKey if it wasn't.
+    quint64 keyFor(int itemId) const { return keys_.value(itemId, kNoKey); }
+
+    // Ids of items with low <= key <= high, in shelf order.
+    QVector<int> range(quint64 low, quint64 high) const;
+    QVector<int> inOrder() const;
+    // Up to radius items on each side of itemId on the shelf, in shelf order
+    // and without itemId itself.
+    QVector<int> near(int itemId, int radius) const;
+
+private:
+    struct Entry {
+        quint64 key;
+        int itemId;
+        bool operator<(const Entry& o) const { return key != o.key ? key < o.key : itemId < o.itemId; }
+    };
+    static const int kMaxBlock = 512;
+
+    int blockFor(const Entry& e) const;   // first block whose last entry >= e
+    void insert(const Entry& e);
+    void erase(const Entry& e);
+
+    QVector<QVector<Entry> > blocks_;     // each sorted and non-empty
+    QHash<int, quint64> keys_;            // item id -> key
+};
+
+#endif // DEWEYINDEX_H
@@ -0,0 +1,164 @@
+#include "duescheduler.h"
+#include <algorithm>
+
+DueScheduler::DueScheduler(const QDate& today)
+    : now_((today.isValid() ? today : QDate::currentDate()).toJulianDay()), wheel_(kSlots) {}
+
+DueScheduler::Event DueScheduler::eventOf(qint64 key, const Entry& e) {
+    Event ev;
+    ev.kind = Kind(key & 1);
+    ev.itemId = int(key >> 1);
+    ev.userId = e.userId;
+    ev.day = QDate::fromJulianDay(e.fire - 1);
+    return ev;
+}
+
+void DueScheduler::place(const Ref& ref, qint64 fire) {
+    if (fire <= now_) {
+        late_.append(ref);
+    } else if (fire <= now_ + kSlots) {
+        wheel_[fire & (kSlots - 1)].append(ref);
+        ++inWheel_;
+    } else {
+        far_[fire].append(ref);
+    }
+}
+
+// Moves overflow timers that now fall inside the wheel's window into it.
+void DueScheduler::pullFar() {
+    while (!far_.isEmpty() && far_.firstKey() <= now_ + kSlots) {
+        auto first = far_.begin();
+        wheel_[first.key() & (kSlots - 1)] += first.value();
+        inWheel_ += first.value().size();
+        far_.erase(first);
+    }
+}
+
+bool DueScheduler::live(const Ref& ref, qint64 fire) const {
+    auto i = entries_.constFind(ref.key);
+    return i != entries_.constEnd() && i->gen == ref.gen && i->fire == fire;
+}
+
+void DueScheduler::compact() {
+    for (auto& bucket : wheel_) bucket.clear();
+    far_.clear();
+    late_.clear();
+    inWheel_ = 0;
+    stale_ = 0;
+    for (auto i = entries_.constBegin(); i != entries_.constEnd(); ++i) {
+        const Ref ref = { i.key(), i->gen };
+        place(ref, i->fire);
+    }
+}
+
+void DueScheduler::clear() {
+    entries_.clear();
+    overdue_.clear();
+    compact();
+}
+
+void DueScheduler::schedule(Kind kind, int itemId, int userId, const QDate& day) {
+    if (!day.isValid()) { cancel(kind, itemId); return; }
+    const qint64 key = keyOf(kind, itemId);
+    const qint64 fire = day.toJulianDay() + 1;
+
+    if (kind == LoanDue) {
+        // Already fired for this very loan: keep it overdue, don't fire twice.
+        auto o = overdue_.constFind(itemId);
+        if (o != overdue_.constEnd() && o->userId == userId && o->day == day) return;
+        overdue_.remove(itemId);
+    }
+    auto i = entries_.constFind(key);
+    if (i != entries_.constEnd()) {
+        if (i->fire == fire && i->userId == userId) return;
+        ++stale_;
+    }
+    const Entry e = { fire, userId, nextGen_++ };
+    entries_.insert(key, e);
+    const Ref ref = { key, e.gen };
+    place(ref, fire);
+    if (stale_ > qMax(1024, int(entries_.size()))) compact();
+}
+
+bool DueScheduler::cancel(Kind kind, int itemId) {
+    bool had = kind == LoanDue && overdue_.remove(itemId) > 0;
+    if (entries_.remove(keyOf(kind, itemId)) > 0) {
+        ++stale_;
+        had = true;
+        if (stale_ > qMax(1024, int(entries_.size()))) compact();
+    }
+    return had;
+}
+
+bool DueScheduler::scheduled(Kind kind, int itemId, int* userId, QDate* day) const {
+    auto i = entries_.constFind(keyOf(kind, itemId));
+    if (i == entries_.constEnd()) return false;
+    if (userId) *userId = i->userId;
+    if (day) *day = QDate::fromJulianDay(i->fire - 1);
+    return true;
+}
+
+QVector<DueScheduler::Event> DueScheduler::advanceTo(const QDate& today) {
+    QVector<Event> out;
+    auto fire = [&](const Ref& ref) {
+        auto i = entries_.find(ref.key);
+        if (i == entries_.end() || i->gen != ref.gen) { --stale_; return; }
+        const Event ev = eventOf(ref.key, *i);
+        entries_.erase(i);
+        if (ev.kind == LoanDue) overdue_.insert(ev.itemId, ev);
+        out.append(ev);
+    };
+
+    for (const Ref& ref : late_) fire(ref);
+    late_.clear();
+
+    const qint64 target = today.isValid() ? today.toJulianDay() : now_;
+    while (now_ < target) {
+        if (inWheel_ == 0) {
+            // Nothing within the window: jump straight to the next timer.
+            const qint64 jump = far_.isEmpty() ? target : qMin(target, far_.firstKey() - 1);
+            if (jump > now_) { now_ = jump; pullFar(); continue; }
+        }
+        ++now_;
+        QVector<Ref> bucket;
+        bucket.swap(wheel_[now_ & (kSlots - 1)]);
+        inWheel_ -= bucket.size();
+        for (const Ref& ref : bucket) fire(ref);
+        pullFar();
+    }
+
+    std::sort(out.begin(), out.end(), [](const Event& a, const Event& b) {
+        if (a.day != b.day) return a.day < b.day;
+        if (a.itemId != b.itemId) return a.itemId < b.itemId;
+        return a.kind < b.kind;
+    });
+    return out;
+}
+
+QVector<DueScheduler::Event> DueScheduler::dueOn(const QDate& day) const {
+    QVector<Event> out;
+    if (!day.isValid()) return out;
+    const qint64 fire = day.toJulianDay() + 1;
+
+    const QVector<Ref>* refs = nullptr;
+    if (fire <= now_) {
+        refs = &late_;
+    } else if (fire <= now_ + kSlots) {
+        refs = &wheel_.at(fire & (kSlots - 1));
+    } else {
+        auto i = far_.constFind(fire);
+        if (i != far_.constEnd()) refs = &i.value();
+    }
+    if (!refs) return out;
+    for (const Ref& ref : *refs)
+        if (live(ref, fire)) out.append(eventOf(ref.key, entries_.value(ref.key)));
+    return out;
+}
+
+QVector<DueScheduler::Event> DueScheduler::overdue() const {
+    QVector<Event> out = overdue_.values();
+    std::sort(out.begin(), out.end(), [](const Event& a, const Event& b) {
+        return a.day != b.day ? a.day < b.day : a.itemId < b.itemId;
+    });
+    return out;
+}
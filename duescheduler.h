@@ -0,0 +1,75 @@
+#ifndef DUESCHEDULER_H
+#define DUESCHEDULER_H
+
+#include <QDate>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+
+// Date-keyed timers for loans and hold pickups, one per (kind, item).
+//
+// A timer "fires" on the first day after its date: a loan due on the 10th
+// is overdue on the 11th. Timers due within kSlots days sit in a wheel of
+// day buckets, later ones in an ordered overflow map that feeds the wheel
+// as days pass, so advanceTo() costs O(days advanced + timers fired) and
+// never walks the catalogue. Rescheduling or cancelling leaves a stale
+// reference behind that is skipped when its bucket drains.
+class DueScheduler {
+public:
+    enum Kind : quint8 { LoanDue, HoldPickup };
+
+    struct Event {
+        Kind  kind;
+        int   itemId;
+        int   userId;
+        QDate day;      // the due / last pickup day
+    };
+
+    explicit DueScheduler(const QDate& today = QDate());
+
+    // Replaces any timer of the same kind for the item.
+    void schedule(Kind kind, int itemId, int userId, const QDate& day);
+    bool cancel(Kind kind, int itemId);
+    bool scheduled(Kind kind, int itemId, int* userId = nullptr, QDate* day = nullptr) const;
+
+    // Moves time forward and returns every timer whose day is now past, in
+    // day order. Fired loan timers stay listed in overdue() until cancelled.
+    QVector<Event> advanceTo(const QDate& today);
+
+    // Timers that fire once `day` is over; O(timers that day) in the window.
+    QVector<Event> dueOn(const QDate& day) const;
+
+    // Loans that have fired and not been cancelled (returned) since.
+    QVector<Event> overdue() const;
+
+    QDate today() const { return QDate::fromJulianDay(now_); }
+    int size() const { return entries_.size(); }
+    void clear();
+
+private:
+    static const int kSlots = 64;   // power of two; covers a 14-day loan easily
+
+    struct Entry { qint64 fire; int userId; quint32 gen; };
+    struct Ref   { qint64 key;  quint32 gen; };
+
+    static qint64 keyOf(Kind kind, int itemId) { return (qint64(itemId) << 1) | kind; }
+    static Event  eventOf(qint64 key, const Entry& e);
+
+    void place(const Ref& ref, qint64 fire);
+    void pullFar();
+    bool live(const Ref& ref, qint64 fire) const;
+    void compact();
+
+    qint64 now_;                        // julian day of the last advance
+    quint32 nextGen_ = 1;
+    int inWheel_ = 0;                   // refs in wheel_, stale ones included
+    int stale_ = 0;                     // refs anywhere whose entry moved on
+
+    QHash<qint64, Entry> entries_;      // keyOf(kind, item) -> timer
+    QVector<QVector<Ref>> wheel_;       // fire day & (kSlots-1)
+    QMap<qint64, QVector<Ref>> far_;    // fire day -> refs, beyond the wheel
+    QVector<Ref> late_;                 // scheduled for a day already past
+    QHash<int, Event> overdue_;         // item id -> fired loan
+};
+
+#endif // DUESCHEDULER_H
@@ -0,0 +1,166 @@
+#include "facetindex.h"
+#include <algorithm>
+
+int FacetIndex::Field::codeFor(const QString& label) {
+    const QString key = label.toLower();
+    auto found = codes.constFind(key);
+    if (found != codes.constEnd()) return found.value();
+    const int code = labels.size();
+    labels.append(label);
+    codes.insert(key, code);
+    bitmaps.append(RowBitmap());
+    return code;
+}
+
+void FacetIndex::Field::set(int row, int code) {
+    const int old = rowCode.at(row);
+    if (old == code) return;
+    if (old >= 0) bitmaps[old].remove(quint32(row));
+    if (code >= 0) bitmaps[code].add(quint32(row));
+    rowCode[row] = code;
+}
+
+QString FacetIndex::deweyClassOf(const QString& dewey) {
+    for (QChar c : dewey) {
+        if (c.isSpace()) continue;
+        if (c.isDigit()) return QString(c) + "00";
+        break;
+    }
+    return QString();
+}
+
+QString FacetIndex::labelOf(Facet f, const Item& it) {
+    switch (f) {
+        case Facet::Type:       return toString(it.type);
+        case Facet::Status:     return toString(it.status);
+        case Facet::Genre:      return it.genre.trimmed();
+        case Facet::Rating:     return it.rating.trimmed();
+        case Facet::DeweyClass: return deweyClassOf(it.dewey);
+    }
+    return QString();
+}
+
+// Type and status codes are the enum values (see clear()).
+int FacetIndex::codeOf(Facet f, const Item& it) {
+    if (f == Facet::Type)   return int(it.type);
+    if (f == Facet::Status) return int(it.status);
+    const QString label = labelOf(f, it);
+    return label.isEmpty() ? -1 : fields_[int(f)].codeFor(label);
+}
+
+void FacetIndex::clear() {
+    for (auto& field : fields_) field = Field();
+    rows_ = 0;
+    const ItemType types[] = { ItemType::Fiction, ItemType::NonFiction, ItemType::Magazine,
+                               ItemType::Movie, ItemType::VideoGame };
+    for (ItemType t : types) fields_[int(Facet::Type)].codeFor(toString(t));
+    fields_[int(Facet::Status)].codeFor(toString(Availability::Available));
+    fields_[int(Facet::Status)].codeFor(toString(Availability::CheckedOut));
+}
+
+void FacetIndex::rebuild(const QList<Item>& items) {
+    clear();
+    for (auto& field : fields_) field.rowCode.reserve(items.size());
+    for (const auto& it : items) append(it);
+}
+
+void FacetIndex::append(const Item& it) {
+    for (int f = 0; f < kFields; ++f) {
+        fields_[f].rowCode.append(-1);
+        fields_[f].set(rows_, codeOf(Facet(f), it));
+    }
+    ++rows_;
+}
+
+// For edits that may have changed anything; text facets are compared in
+// place before any lower-casing or lookup.
+void FacetIndex::update(int row, const Item& it) {
+    if (row < 0 || row >= rows_) return;
+    for (int f = 0; f < kFields; ++f) {
+        Field& field = fields_[f];
+        if (Facet(f) != Facet::Type && Facet(f) != Facet::Status) {
+            const QString label = labelOf(Facet(f), it);
+            const int cur = field.rowCode.at(row);
+            if (cur >= 0 ? field.labels.at(cur).compare(label, Qt::CaseInsensitive) == 0 : label.isEmpty())
+                continue;
+        }
+        field.set(row, codeOf(Facet(f), it));
+    }
+}
+
+void FacetIndex::updateStatus(int row, Availability status) {
+    if (row < 0 || row >= rows_) return;
+    fields_[int(Facet::Status)].set(row, int(status));
+}
+
+bool FacetIndex::match(const FacetQuery& q, RowBitmap* out) const {
+    // Per constrained facet, its one wanted value's bitmap, or the union of
+    // several. Single values are used in place rather than copied.
+    static const RowBitmap kNone;
+    QVector<RowBitmap> unions;
+    unions.reserve(kFields);              // keeps pointers into it stable
+    QVector<const RowBitmap*> wanted;
+    auto want = [&](Facet f, const QStringList& labels) {
+        if (labels.isEmpty()) return;
+        const Field& field = fields_[int(f)];
+        QVector<int> codes;
+        for (const auto& label : labels) {
+            const int code = field.codes.value(label.trimmed().toLower(), -1);
+            if (code >= 0 && !codes.contains(code)) codes.append(code);
+        }
+        if (codes.size() <= 1) {
+            wanted.append(codes.isEmpty() ? &kNone : &field.bitmaps.at(codes.first()));
+            return;
+        }
+        unions.append(field.bitmaps.at(codes.first()));
+        for (int i = 1; i < codes.size(); ++i) unions.last() |= field.bitmaps.at(codes.at(i));
+        wanted.append(&unions.last());
+    };
+
+    QStringList types, statuses, classes;
+    for (ItemType t : q.types) types << toString(t);
+    for (Availability a : q.statuses) statuses << toString(a);
+    for (int c : q.deweyClasses) classes << QString::number(c * 100).rightJustified(3, '0');
+    want(Facet::Type, types);
+    want(Facet::Status, statuses);
+    want(Facet::Genre, q.genres);
+    want(Facet::Rating, q.ratings);
+    want(Facet::DeweyClass, classes);
+    if (wanted.isEmpty()) return false;
+
+    // Smallest first, so the running intersection is small from the start.
+    std::sort(wanted.begin(), wanted.end(),
+              [](const RowBitmap* a, const RowBitmap* b) { return a->count() < b->count(); });
+    *out = *wanted.first();
+    for (int i = 1; i < wanted.size() && !out->isEmpty(); ++i) *out &= *wanted.at(i);
+    return true;
+}
+
+QVector<quint32> FacetIndex::rows(const FacetQuery& q) const {
+    RowBitmap hits;
+    if (match(q, &hits)) return hits.rows();
+    QVector<quint32> all(rows_);
+    for (int r = 0; r < rows_; ++r) all[r] = quint32(r);
+    return all;
+}
+
+int FacetIndex::count(const FacetQuery& q) const {
+    RowBitmap hits;
+    return match(q, &hits) ? hits.count() : rows_;
+}
+
+QVector<FacetCount> FacetIndex::counts(Facet f, const FacetQuery& q) const {
+    RowBitmap hits;
+    const bool filtered = match(q, &hits);
+    const Field& field = fields_[int(f)];
+    QVector<FacetCount> out;
+    for (int code = 0; code < field.labels.size(); ++code) {
+        const RowBitmap& rows = field.bitmaps.at(code);
+        const int n = filtered ? RowBitmap::intersectionCount(hits, rows) : rows.count();
+        if (n > 0) out.append(FacetCount{ field.labels.at(code), n });
+    }
+    std::sort(out.begin(), out.end(), [](const FacetCount& a, const FacetCount& b) {
+        return a.count != b.count ? a.count > b.count : a.value < b.value;
+    });
+    return out;
+}
@@ -0,0 +1,73 @@
+#ifndef FACETINDEX_H
+#define FACETINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include "item.h"
+#include "rowbitmap.h"
+
+// Attributes patrons and staff browse by.
+enum class Facet { Type, Status, Genre, Rating, DeweyClass };
+
+// A row matches when, for every facet that lists values, it has one of them.
+// Text compares case-insensitively; Dewey classes are 0..9 (000s..900s).
+struct FacetQuery {
+    QList<ItemType> types;
+    QList<Availability> statuses;
+    QStringList genres;
+    QStringList ratings;
+    QList<int> deweyClasses;
+};
+
+struct FacetCount {
+    QString value;   // as shown: "Video Game", "RPG", "500", ...
+    int count;
+};
+
+// Bitmap indexes over Catalogue::items, one RowBitmap per facet value holding
+// the rows (positions in items) that have it. A combined query intersects the
+// per-facet bitmaps, so "available RPG games rated T" touches four bitmaps
+// instead of every item, and facet counts are intersection counts.
+class FacetIndex {
+public:
+    FacetIndex() { clear(); }
+
+    void clear();
+    void rebuild(const QList<Item>& items);
+    void append(const Item& it);            // as the next row
+    void update(int row, const Item& it);   // cheap when nothing indexed changed
+    void updateStatus(int row, Availability status);   // circulation: nothing else moved
+    int size() const { return rows_; }
+
+    // Matching rows, ascending; every row for an empty query.
+    QVector<quint32> rows(const FacetQuery& q) const;
+    int count(const FacetQuery& q) const;
+
+    // How many rows matching q have each value of f, most common first.
+    QVector<FacetCount> counts(Facet f, const FacetQuery& q = FacetQuery()) const;
+
+    // "510.9" -> "500"; empty when the call number doesn't start with a digit.
+    static QString deweyClassOf(const QString& dewey);
+
+private:
+    struct Field {
+        QVector<RowBitmap> bitmaps;   // per value code
+        QStringList labels;           // display value per code
+        QHash<QString, int> codes;    // lower-cased label -> code
+        QVector<int> rowCode;         // per row; -1 = no value
+        int codeFor(const QString& label);
+        void set(int row, int code);
+    };
+    static const int kFields = 5;
+
+    static QString labelOf(Facet f, const Item& it);
+    int codeOf(Facet f, const Item& it);
+    // Rows satisfying every constrained facet of q; false when q constrains none.
+    bool match(const FacetQuery& q, RowBitmap* out) const;
+
+    Field fields_[kFields];
+    int rows_ = 0;
+};
+
+#endif // FACETINDEX_H
@@ -0,0 +1,89 @@
+#include "holdqueue.h"
+
+static inline int lowbit(int i) { return i & -i; }
+
+int HoldQueue::liveThrough(int slot) const {
+    int sum = 0;
+    for (int i = slot + 1; i > 0; i -= lowbit(i)) sum += tree_.at(i - 1);
+    return sum;
+}
+
+int HoldQueue::indexOf(int userId) const {
+    const int slot = slotOf_.value(userId, -1);
+    return slot < 0 ? -1 : liveThrough(slot) - 1;
+}
+
+void HoldQueue::append(int userId) {
+    if (userId < 0 || slotOf_.contains(userId)) return;
+    // Node i covers (i - lowbit(i), i]; its children already hold the sums
+    // of everything in that range except the new element itself.
+    const int i = users_.size() + 1;
+    int node = 1;
+    for (int j = i - 1; j > i - lowbit(i); j -= lowbit(j)) node += tree_.at(j - 1);
+
+    users_.append(userId);
+    tree_.append(node);
+    slotOf_.insert(userId, i - 1);
+    ++live_;
+}
+
+void HoldQueue::removeSlot(int slot) {
+    slotOf_.remove(users_.at(slot));
+    users_[slot] = -1;
+    for (int i = slot + 1; i <= tree_.size(); i += lowbit(i)) tree_[i - 1] -= 1;
+    --live_;
+
+    if (live_ == 0) { clear(); return; }
+    while (users_.at(head_) < 0) ++head_;
+    if (users_.size() - live_ > qMax(32, live_)) compact();
+}
+
+void HoldQueue::pop_front() {
+    if (!isEmpty()) removeSlot(head_);
+}
+
+int HoldQueue::removeAll(int userId) {
+    const int slot = slotOf_.value(userId, -1);
+    if (slot < 0) return 0;
+    removeSlot(slot);
+    return 1;
+}
+
+void HoldQueue::clear() {
+    users_.clear();
+    tree_.clear();
+    slotOf_.clear();
+    head_ = 0;
+    live_ = 0;
+}
+
+void HoldQueue::compact() {
+    const QList<int> order = toList();
+    clear();
+    users_.reserve(order.size());
+    tree_.reserve(order.size());
+    for (int u : order) append(u);
+}
+
+QList<int> HoldQueue::toList() const {
+    QList<int> out;
+    out.reserve(live_);
+    for (int i = head_; i < users_.size(); ++i)
+        if (users_.at(i) >= 0) out.append(users_.at(i));
+    return out;
+}
+
+HoldQueue HoldQueue::fromList(const QList<int>& userIds) {
+    HoldQueue q;
+    for (int u : userIds) q.append(u);
+    return q;
+}
+
+// Every change to a queue adds or drops one holder, and adds go at the end,
+// so replaying them this way keeps the mirror in the same order.
+void HoldQueue::follow(const HoldQueue& queue, int userId) {
+    const bool queued = queue.contains(userId);
+    if (queued == contains(userId)) return;
+    if (queued) append(userId);
+    else        removeAll(userId);
+}
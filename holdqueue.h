@@ -0,0 +1,53 @@
+#ifndef HOLDQUEUE_H
+#define HOLDQUEUE_H
+
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+// Strict FIFO queue of user ids with the QList<int> calls the controller
+// used before. Every holder keeps the slot it joined at; a hash gives O(1)
+// membership and a Fenwick tree over "still queued" flags turns a slot into
+// a queue position in O(log n), so cancelling from the middle is cheap.
+// Cancelled slots are compacted away once they outnumber live ones.
+class HoldQueue {
+public:
+    bool isEmpty() const { return live_ == 0; }
+    int  size() const { return live_; }
+    bool contains(int userId) const { return slotOf_.contains(userId); }
+
+    int  first() const { return users_.at(head_); }   // requires !isEmpty()
+    int  indexOf(int userId) const;                    // 0-based, -1 if absent
+
+    void append(int userId);                           // no-op if already queued
+    void pop_front();
+    int  removeAll(int userId);                        // 1 if removed, else 0
+    void clear();
+
+    QList<int> toList() const;
+    static HoldQueue fromList(const QList<int>& userIds);
+
+    // For mirrors of a queue (snapshots, columns). Assigning one queue to
+    // another shares its storage, so the next change to either copies all
+    // of it; a mirror instead starts from copy() and then follows the
+    // queue one change at a time with follow(), which appends userId or
+    // removes it so its membership matches `queue`'s, in O(log n).
+    HoldQueue copy() const { return fromList(toList()); }
+    void follow(const HoldQueue& queue, int userId);
+
+    bool operator==(const HoldQueue& o) const { return toList() == o.toList(); }
+    bool operator!=(const HoldQueue& o) const { return !(*this == o); }
+
+private:
+    void removeSlot(int slot);
+    void compact();
+    int  liveThrough(int slot) const;                  // live entries in [0, slot]
+
+    QVector<int> users_;      // slot -> user id, -1 once removed
+    QVector<int> tree_;       // Fenwick tree over live flags, 1-based
+    QHash<int, int> slotOf_;  // user id -> slot
+    int head_ = 0;            // first live slot (== users_.size() when empty)
+    int live_ = 0;
+};
+
+#endif // HOLDQUEUE_H
@@ -1,16 +1,17 @@
 #include "item.h"
+#include "itempolicy.h"
 
 QString toString(ItemType t) {
-    switch (t) {
-        case ItemType::Fiction:    return "Fiction";
-        case ItemType::NonFiction: return "Non-Fiction";
-        case ItemType::Magazine:   return "Magazine";
-        case ItemType::Movie:      return "Movie";
-        case ItemType::VideoGame:  return "Video Game";
-    }
-    return "Unknown";
+    return itemTypeInfo(t).name;
 }
 
 QString toString(Availability a) {
-    return (a == Availability::Available) ? "Available" : "Checked out";
+    static const QString kAvailable = QStringLiteral("Available");
+    static const QString kCheckedOut = QStringLiteral("Checked out");
+    return a == Availability::Available ? kAvailable : kCheckedOut;
 }
+
+QString extra1Header(ItemType t)  { return itemTypeInfo(t).extra1Header; }
+QString extra2Header(ItemType t)  { return itemTypeInfo(t).extra2Header; }
+QString extra1Value(const Item& it) { return itemTypeInfo(it.type).extra1(it); }
+QString extra2Value(const Item& it) { return itemTypeInfo(it.type).extra2(it); }
@@ -4,6 +4,7 @@
 #include <QString>
 #include <QDate>
 #include <QList>
+#include "holdqueue.h"
 
 enum class ItemType { Fiction, NonFiction, Magazine, Movie, VideoGame };
 enum class Availability { Available, CheckedOut };
@@ -16,6 +17,7 @@ struct Item {
     Availability status = Availability::Available;
     int borrowerId = -1;      // -1 = none
     QDate due;                // valid only when checked out
+    QDate pickupBy;           // available with holders: the first one's deadline
 
     // Type-specific optional fields (used per requirements)
     QString dewey;            // Non-fiction
@@ -24,10 +26,16 @@ struct Item {
     QString genre;            // Movie / VideoGame
     QString rating;           // Movie / VideoGame (e.g., PG-13, M)
 
-    QList<int> holdQueue;     // FIFO queue of user IDs
+    HoldQueue holdQueue;      // FIFO queue of user IDs
 };
 
 QString toString(ItemType t);
 QString toString(Availability a);
 
+// Type-specific "extra" columns shown in the items table and details panel.
+QString extra1Header(ItemType t);
+QString extra2Header(ItemType t);
+QString extra1Value(const Item& it);
+QString extra2Value(const Item& it);
+
 #endif // ITEM_H
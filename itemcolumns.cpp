@@ -0,0 +1,105 @@
+#include "itemcolumns.h"
+#include <limits>
+
+const qint64 ItemColumns::kNoDay = std::numeric_limits<qint64>::min();
+
+static qint64 dayOf(const QDate& d) { return d.isValid() ? d.toJulianDay() : ItemColumns::kNoDay; }
+static QDate dateOf(qint64 jd) { return jd == ItemColumns::kNoDay ? QDate() : QDate::fromJulianDay(jd); }
+
+void ItemColumns::clear() {
+    id.clear(); type.clear(); status.clear(); borrowerId.clear(); due.clear();
+    title.clear(); creator.clear(); dewey.clear(); issue.clear(); genre.clear(); rating.clear();
+    pub.clear(); pickupBy.clear(); holdQueue.clear();
+    text.clear();
+}
+
+void ItemColumns::rebuild(const QList<Item>& items) {
+    clear();
+    const int n = items.size();
+    id.reserve(n); type.reserve(n); status.reserve(n); borrowerId.reserve(n); due.reserve(n);
+    title.reserve(n); creator.reserve(n); dewey.reserve(n); issue.reserve(n); genre.reserve(n);
+    rating.reserve(n); pub.reserve(n); pickupBy.reserve(n); holdQueue.reserve(n);
+    for (const auto& it : items) append(it);
+}
+
+void ItemColumns::append(const Item& it) {
+    const int row = size();
+    id.resize(row + 1); type.resize(row + 1); status.resize(row + 1);
+    borrowerId.resize(row + 1); due.resize(row + 1);
+    title.resize(row + 1); creator.resize(row + 1); dewey.resize(row + 1);
+    issue.resize(row + 1); genre.resize(row + 1); rating.resize(row + 1);
+    pub.resize(row + 1); pickupBy.resize(row + 1); holdQueue.resize(row + 1);
+    store(row, it);
+}
+
+void ItemColumns::update(int row, const Item& it) {
+    if (row < 0 || row >= size()) return;
+    store(row, it);
+}
+
+// Leaves the text columns (and the shared TextTable) alone.
+void ItemColumns::updateCirculation(int row, const Item& it, int userId) {
+    if (row < 0 || row >= size()) return;
+    status[row]     = quint8(it.status);
+    borrowerId[row] = it.borrowerId;
+    due[row]        = dayOf(it.due);
+    pickupBy[row]   = dayOf(it.pickupBy);
+    if (userId >= 0) holdQueue[row].follow(it.holdQueue, userId);
+}
+
+void ItemColumns::removeAt(int row) {
+    if (row < 0 || row >= size()) return;
+    id.remove(row); type.remove(row); status.remove(row); borrowerId.remove(row); due.remove(row);
+    title.remove(row); creator.remove(row); dewey.remove(row); issue.remove(row);
+    genre.remove(row); rating.remove(row); pub.remove(row); pickupBy.remove(row); holdQueue.remove(row);
+}
+
+void ItemColumns::store(int row, const Item& it) {
+    id[row]         = it.id;
+    type[row]       = quint8(it.type);
+    status[row]     = quint8(it.status);
+    borrowerId[row] = it.borrowerId;
+    due[row]        = dayOf(it.due);
+
+    title[row]   = text.intern(it.title);
+    creator[row] = text.intern(it.creator);
+    dewey[row]   = text.intern(it.dewey);
+    issue[row]   = text.intern(it.issue);
+    genre[row]   = text.intern(it.genre);
+    rating[row]  = text.intern(it.rating);
+    pub[row]     = dayOf(it.pub);
+    pickupBy[row] = dayOf(it.pickupBy);
+    holdQueue[row] = it.holdQueue.copy();   // not shared: see HoldQueue::follow
+}
+
+Item ItemColumns::at(int row) const {
+    Item it;
+    if (row < 0 || row >= size()) return it;
+    it.id         = id.at(row);
+    it.type       = ItemType(type.at(row));
+    it.status     = Availability(status.at(row));
+    it.borrowerId = borrowerId.at(row);
+    it.due        = dateOf(due.at(row));
+    it.title      = text.at(title.at(row));
+    it.creator    = text.at(creator.at(row));
+    it.dewey      = text.at(dewey.at(row));
+    it.issue      = text.at(issue.at(row));
+    it.genre      = text.at(genre.at(row));
+    it.rating     = text.at(rating.at(row));
+    it.pub        = dateOf(pub.at(row));
+    it.pickupBy   = dateOf(pickupBy.at(row));
+    it.holdQueue  = holdQueue.at(row);
+    return it;
+}
+
+QVector<int> ItemColumns::availableOfType(ItemType t) const {
+    QVector<int> out;
+    const quint8 want = quint8(t);
+    const quint8 avail = quint8(Availability::Available);
+    const quint8* ty = type.constData();
+    const quint8* st = status.constData();
+    const int* ids = id.constData();
+    for (int i = 0, n = size(); i < n; ++i)
+        if (ty[i] == want && st[i] == avail) out.append(ids[i]);
+    return out;
+}
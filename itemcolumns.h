@@ -0,0 +1,50 @@
+#ifndef ITEMCOLUMNS_H
+#define ITEMCOLUMNS_H
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include "item.h"
+#include "texttable.h"
+
+// Column-oriented mirror of Catalogue::items. The fields that scans filter on
+// live in dense parallel arrays (one row per item, same order as items);
+// text lives in a TextTable. at() rebuilds an Item for existing callers.
+class ItemColumns {
+public:
+    static const qint64 kNoDay;   // julian day stored for an invalid QDate
+
+    void rebuild(const QList<Item>& items);
+    void append(const Item& it);
+    void update(int row, const Item& it);
+    // Status, borrower, due, pickup, and userId's place in the hold queue
+    // (see Catalogue::touchCirculation).
+    void updateCirculation(int row, const Item& it, int userId = -1);
+    void removeAt(int row);
+    void clear();
+
+    int size() const { return id.size(); }
+    Item at(int row) const;
+
+    // Ids of every available item of type t, in catalogue order.
+    QVector<int> availableOfType(ItemType t) const;
+
+    // Hot columns
+    QVector<int>     id;
+    QVector<quint8>  type;
+    QVector<quint8>  status;
+    QVector<int>     borrowerId;
+    QVector<qint64>  due;
+
+    // Cold columns
+    QVector<quint32> title, creator, dewey, issue, genre, rating;
+    QVector<qint64>  pub;
+    QVector<qint64>  pickupBy;
+    QVector<HoldQueue> holdQueue;
+    TextTable text;
+
+private:
+    void store(int row, const Item& it);
+};
+
+#endif // ITEMCOLUMNS_H
@@ -0,0 +1,46 @@
+#include "itempolicy.h"
+
+namespace {
+
+const char* fieldLabel(ItemField f, const char* none) {
+    switch (f) {
+        case ItemField::Dewey:     return "Dewey";
+        case ItemField::Issue:     return "Issue";
+        case ItemField::Published: return "Published";
+        case ItemField::Genre:     return "Genre";
+        case ItemField::Rating:    return "Rating";
+        case ItemField::None:      break;
+    }
+    return none;
+}
+
+template <ItemType T> ItemTypeInfo infoFor() {
+    typedef ItemPolicy<T> P;
+    ItemTypeInfo info;
+    info.name = QString::fromLatin1(P::kName);
+    info.extra1Header = QString::fromLatin1(fieldLabel(P::kExtra1, "Extra 1"));
+    info.extra2Header = QString::fromLatin1(fieldLabel(P::kExtra2, "Extra 2"));
+    info.extra1 = &fieldValue<P::kExtra1>;
+    info.extra2 = &fieldValue<P::kExtra2>;
+    info.loanDays = P::kLoanDays;
+    info.maxLoans = P::kMaxLoans;
+    return info;
+}
+
+} // namespace
+
+// Indexed by ItemType's value; built on first use. The last row catches
+// values outside the enum (e.g. from a damaged snapshot).
+const ItemTypeInfo& itemTypeInfo(ItemType t) {
+    static const ItemTypeInfo kTable[kItemTypeCount + 1] = {
+        infoFor<ItemType::Fiction>(),
+        infoFor<ItemType::NonFiction>(),
+        infoFor<ItemType::Magazine>(),
+        infoFor<ItemType::Movie>(),
+        infoFor<ItemType::VideoGame>(),
+        { "Unknown", "Extra 1", "Extra 2", &fieldValue<ItemField::None>, &fieldValue<ItemField::None>,
+          StandardLoanTerms::kLoanDays, StandardLoanTerms::kMaxLoans }
+    };
+    const unsigned i = unsigned(t);
+    return kTable[i < unsigned(kItemTypeCount) ? i : kItemTypeCount];
+}
@@ -0,0 +1,75 @@
+#ifndef ITEMPOLICY_H
+#define ITEMPOLICY_H
+
+#include <QString>
+#include "item.h"
+
+// The Item field an extra column shows.
+enum class ItemField { None, Dewey, Issue, Published, Genre, Rating };
+
+// Everything type-specific about an item, fixed at compile time: its display
+// name, what its two extra columns show, and its loan terms. A new ItemType
+// needs a specialization here and a row in itempolicy.cpp; nothing else
+// switches on the type.
+template <ItemType T> struct ItemPolicy;
+
+struct StandardLoanTerms {
+    static constexpr int kLoanDays = 14;
+    static constexpr int kMaxLoans = 3;    // of this type, within the overall cap
+};
+
+template <> struct ItemPolicy<ItemType::Fiction> : StandardLoanTerms {
+    static constexpr const char* kName = "Fiction";
+    static constexpr ItemField kExtra1 = ItemField::None;
+    static constexpr ItemField kExtra2 = ItemField::None;
+};
+template <> struct ItemPolicy<ItemType::NonFiction> : StandardLoanTerms {
+    static constexpr const char* kName = "Non-Fiction";
+    static constexpr ItemField kExtra1 = ItemField::Dewey;
+    static constexpr ItemField kExtra2 = ItemField::None;
+};
+template <> struct ItemPolicy<ItemType::Magazine> : StandardLoanTerms {
+    static constexpr const char* kName = "Magazine";
+    static constexpr ItemField kExtra1 = ItemField::Issue;
+    static constexpr ItemField kExtra2 = ItemField::Published;
+};
+template <> struct ItemPolicy<ItemType::Movie> : StandardLoanTerms {
+    static constexpr const char* kName = "Movie";
+    static constexpr ItemField kExtra1 = ItemField::Genre;
+    static constexpr ItemField kExtra2 = ItemField::Rating;
+};
+template <> struct ItemPolicy<ItemType::VideoGame> : StandardLoanTerms {
+    static constexpr const char* kName = "Video Game";
+    static constexpr ItemField kExtra1 = ItemField::Genre;
+    static constexpr ItemField kExtra2 = ItemField::Rating;
+};
+
+const int kItemTypeCount = 5;
+
+// A field's text, one specialization per field.
+template <ItemField F> QString fieldValue(const Item& it);
+template <> inline QString fieldValue<ItemField::None>(const Item&)         { return QString(); }
+template <> inline QString fieldValue<ItemField::Dewey>(const Item& it)     { return it.dewey; }
+template <> inline QString fieldValue<ItemField::Issue>(const Item& it)     { return it.issue; }
+template <> inline QString fieldValue<ItemField::Genre>(const Item& it)     { return it.genre; }
+template <> inline QString fieldValue<ItemField::Rating>(const Item& it)    { return it.rating; }
+template <> inline QString fieldValue<ItemField::Published>(const Item& it) {
+    return it.pub.isValid() ? it.pub.toString("yyyy-MM-dd") : QString();
+}
+
+// The policies flattened for runtime use: a type is one index into a table
+// built once from the specializations above, instead of a switch per call.
+// Labels are built once and shared, so handing one out copies no text.
+struct ItemTypeInfo {
+    QString name;
+    QString extra1Header;
+    QString extra2Header;
+    QString (*extra1)(const Item&);
+    QString (*extra2)(const Item&);
+    int loanDays;
+    int maxLoans;
+};
+
+const ItemTypeInfo& itemTypeInfo(ItemType t);
+
+#endif // ITEMPOLICY_H
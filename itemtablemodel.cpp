@@ -0,0 +1,175 @@
+#include "itemtablemodel.h"
+#include <algorithm>
+#include <iterator>
+
+ItemTableModel::ItemTableModel(Catalogue* cat, QObject* parent)
+    : QAbstractTableModel(parent), cat_(cat)
+{
+    if (cat_) snap_ = cat_->snapshot();
+}
+
+int ItemTableModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : snap_.itemCount();
+}
+
+int ItemTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ItemTableModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= rowCount()) return QVariant();
+    const Item& it = itemAt(index.row());
+
+    if (role == ItemIdRole) return it.id;
+    if (role != Qt::DisplayRole) return QVariant();
+
+    switch (index.column()) {
+        case ColId:      return it.id;
+        case ColTitle:   return it.title;
+        case ColCreator: return it.creator;
+        case ColType:    return toString(it.type);
+        case ColStatus:  return toString(it.status);
+        case ColDue:     return it.due.isValid() ? it.due.toString("yyyy-MM-dd") : QString();
+        case ColExtra1:  return extra1Value(it);
+        case ColExtra2:  return extra2Value(it);
+    }
+    return QVariant();
+}
+
+QVariant ItemTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+    static const char* const kHeaders[ColumnCount] =
+        {"ID","Title","Creator","Type","Status","Due","Extra 1","Extra 2"};
+    if (section < 0 || section >= ColumnCount) return QVariant();
+    return QString(kHeaders[section]);
+}
+
+const Item& ItemTableModel::itemAt(int row) const {
+    const Item& it = snap_.itemAt(row);
+    if (pending_.isEmpty()) return it;
+    const auto found = pending_.constFind(it.id);
+    return found != pending_.constEnd() ? found.value() : it;
+}
+
+void ItemTableModel::repaint(int itemId) {
+    const int row = cat_ ? cat_->itemSlot(itemId) : -1;
+    if (row < 0 || row >= snap_.itemCount()) return;
+    emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+}
+
+void ItemTableModel::itemsChanged(const QVector<int>& itemIds) {
+    if (!cat_) return;
+    snap_ = cat_->snapshot();
+    for (int id : itemIds) repaint(id);
+}
+
+void ItemTableModel::setPending(const Item& it) {
+    pending_.insert(it.id, it);
+    repaint(it.id);
+}
+
+void ItemTableModel::clearPending(int itemId) {
+    if (pending_.remove(itemId)) repaint(itemId);
+}
+
+void ItemTableModel::rowsChanged(const QVector<int>& rows) {
+    for (int row : rows)
+        if (row >= 0 && row < snap_.itemCount()) emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+}
+
+void ItemTableModel::reload() {
+    beginResetModel();
+    if (cat_) snap_ = cat_->snapshot();
+    endResetModel();
+}
+
+// ---------------------- Sorting ----------------------
+ItemSortProxy::ItemSortProxy(ItemTableModel* source, QObject* parent)
+    : QSortFilterProxyModel(parent), src_(source)
+{
+    setSourceModel(source);
+}
+
+bool ItemSortProxy::lessThan(const QModelIndex& left, const QModelIndex& right) const {
+    const Item& a = src_->itemAt(left.row());
+    const Item& b = src_->itemAt(right.row());
+
+    switch (left.column()) {
+        case ItemTableModel::ColId:      return a.id < b.id;
+        case ItemTableModel::ColTitle:   return a.title.compare(b.title, Qt::CaseInsensitive) < 0;
+        case ItemTableModel::ColCreator: return a.creator.compare(b.creator, Qt::CaseInsensitive) < 0;
+        case ItemTableModel::ColType:    return a.type < b.type;
+        case ItemTableModel::ColStatus:  return a.status < b.status;
+        case ItemTableModel::ColDue:     return a.due < b.due;   // invalid (not on loan) sorts first
+        case ItemTableModel::ColExtra1: {
+            // By (shelf key, text) for every row, one ordering throughout:
+            // non-fiction in shelf order, then everything without a call
+            // number (kNoKey: other types, unparsable ones) by its text.
+            const Catalogue* cat = src_->catalogue();
+            const quint64 ka = a.type == ItemType::NonFiction ? cat->deweyKey(a.id) : DeweyIndex::kNoKey;
+            const quint64 kb = b.type == ItemType::NonFiction ? cat->deweyKey(b.id) : DeweyIndex::kNoKey;
+            if (ka != kb) return ka < kb;
+            return extra1Value(a).compare(extra1Value(b), Qt::CaseInsensitive) < 0;
+        }
+        case ItemTableModel::ColExtra2:
+            if (a.type == ItemType::Magazine && b.type == ItemType::Magazine) return a.pub < b.pub;
+            return extra2Value(a).compare(extra2Value(b), Qt::CaseInsensitive) < 0;
+    }
+    return QSortFilterProxyModel::lessThan(left, right);
+}
+
+QVector<int> ItemSortProxy::rowsOf(const QVector<int>& itemIds) const {
+    const Catalogue* cat = src_->catalogue();
+    const int count = src_->snapshot().itemCount();
+    QVector<int> rows;
+    rows.reserve(itemIds.size());
+    for (int id : itemIds) {
+        const int row = cat->itemSlot(id);
+        if (row >= 0 && row < count) rows.append(row);
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+void ItemSortProxy::setIdFilter(const QVector<int>& itemIds) {
+    rows_ = rowsOf(itemIds);
+    accepted_.fill(false, src_->snapshot().itemCount());
+    for (int row : rows_) accepted_.setBit(row);
+    filtering_ = true;
+    invalidateFilter();
+}
+
+// invalidateFilter() would run filterAcceptsRow over every source row; a
+// narrower query only drops rows, so re-announcing those is enough. When
+// most rows drop, one full pass is cheaper than that many signals.
+void ItemSortProxy::narrowIdFilter(const QVector<int>& itemIds) {
+    if (!filtering_ || accepted_.size() != src_->snapshot().itemCount()) {
+        setIdFilter(itemIds);
+        return;
+    }
+    const QVector<int> rows = rowsOf(itemIds);
+    QVector<int> kept, dropped;
+    std::set_intersection(rows_.begin(), rows_.end(), rows.begin(), rows.end(), std::back_inserter(kept));
+    std::set_difference(rows_.begin(), rows_.end(), rows.begin(), rows.end(), std::back_inserter(dropped));
+    if (dropped.size() > 4096 && dropped.size() > kept.size()) {
+        setIdFilter(itemIds);
+        return;
+    }
+    for (int row : dropped) accepted_.clearBit(row);
+    rows_ = kept;
+    src_->rowsChanged(dropped);
+}
+
+void ItemSortProxy::clearIdFilter() {
+    if (!filtering_) return;
+    filtering_ = false;
+    accepted_.clear();
+    rows_.clear();
+    invalidateFilter();
+}
+
+bool ItemSortProxy::filterAcceptsRow(int sourceRow, const QModelIndex&) const {
+    if (!filtering_) return true;
+    return sourceRow < accepted_.size() && accepted_.testBit(sourceRow);
+}
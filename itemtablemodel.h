@@ -0,0 +1,85 @@
+#ifndef ITEMTABLEMODEL_H
+#define ITEMTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QBitArray>
+#include <QHash>
+#include "catalogue.h"
+#include "cataloguesnapshot.h"
+
+// Read-only view over Catalogue::items. Cells are produced on demand for
+// whatever rows the view paints, from a snapshot retaken on every change
+// notice, so painting never waits on (or stalls) circulation commands.
+class ItemTableModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    enum Column { ColId, ColTitle, ColCreator, ColType, ColStatus, ColDue, ColExtra1, ColExtra2, ColumnCount };
+    enum { ItemIdRole = Qt::UserRole };
+
+    explicit ItemTableModel(Catalogue* cat, QObject* parent=nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    Catalogue* catalogue() const { return cat_; }
+    // The catalogue as of the last change notice; source row == slot.
+    const CatalogueSnapshot& snapshot() const { return snap_; }
+    // What a row shows: its pending item if set, else the snapshot's.
+    const Item& itemAt(int row) const;
+
+    // Retakes the snapshot after a change notice and repaints the rows of
+    // these items (borrow/return); hold-only changes repaint nothing.
+    void itemsChanged(const QVector<int>& itemIds);
+
+    // Optimistic updates: show `it` on its row until clearPending(), e.g.
+    // what a command still running should leave. Clearing rolls the row back
+    // to the snapshot, which by then holds whatever the command really did.
+    void setPending(const Item& it);
+    void clearPending(int itemId);
+
+    // Tells views these rows may read differently, without a reset; a
+    // filtering proxy re-checks just them.
+    void rowsChanged(const QVector<int>& rows);
+
+    // Items were added/removed or replaced wholesale.
+    void reload();
+
+private:
+    void repaint(int itemId);
+
+    Catalogue* cat_;
+    CatalogueSnapshot snap_;
+    QHash<int, Item> pending_;   // item id -> what to show instead
+};
+
+// Sorts by comparing the catalogue fields in place instead of going through
+// QVariant/QString copies of the display text, and optionally restricts the
+// view to a set of item ids (e.g. search hits).
+class ItemSortProxy : public QSortFilterProxyModel {
+    Q_OBJECT
+public:
+    explicit ItemSortProxy(ItemTableModel* source, QObject* parent=nullptr);
+
+    void setIdFilter(const QVector<int>& itemIds);
+    // Like setIdFilter, for ids that are a subset of the current filter's
+    // (the query grew): only the rows that drop out are filtered again.
+    void narrowIdFilter(const QVector<int>& itemIds);
+    void clearIdFilter();
+
+protected:
+    bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+
+private:
+    ItemTableModel* src_;
+    QVector<int> rowsOf(const QVector<int>& itemIds) const;   // ascending
+
+    bool filtering_ = false;
+    QBitArray accepted_;   // by source row
+    QVector<int> rows_;    // the set bits of accepted_, ascending
+};
+
+#endif // ITEMTABLEMODEL_H
@@ -0,0 +1,203 @@
+#include "journal.h"
+#include <QtEndian>
+#include <QMutexLocker>
+#include <limits>
+
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <io.h>
+#endif
+
+// File = 8-byte header, then fixed 32-byte little-endian records:
+//   u64 seq | u8 op | 3 pad | i32 user | i32 item | i64 due (julian) | u32 fnv1a
+static const quint32 kMagic      = 0x4E4A4C48;   // "HLJN"
+static const quint16 kVersion    = 1;
+static const int     kHeaderSize = 8;
+static const int     kRecordSize = 32;
+static const qint64  kNoDay      = std::numeric_limits<qint64>::min();
+
+static quint32 fnv1a(const uchar* p, int n) {
+    quint32 h = 2166136261u;
+    for (int i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+bool syncToDisk(QFileDevice& f) {
+    if (!f.flush()) return false;
+#if defined(Q_OS_UNIX)
+    return ::fsync(f.handle()) == 0;
+#elif defined(Q_OS_WIN)
+    return ::_commit(f.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+Journal::~Journal() { close(); }
+
+bool Journal::open(const QString& path, QList<Record>* records) {
+    close();
+    nextSeq_ = 1;
+    failing_ = false;
+    file_.setFileName(path);
+    // Unbuffered: records are grouped in buffer_, and a failed write must
+    // not leave part of a group in QFile's own buffer.
+    if (!file_.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) return false;
+
+    if (file_.size() < kHeaderSize) {
+        uchar hdr[kHeaderSize] = {};
+        qToLittleEndian<quint32>(kMagic, hdr);
+        qToLittleEndian<quint16>(kVersion, hdr + 4);
+        file_.resize(0);
+        file_.write(reinterpret_cast<const char*>(hdr), kHeaderSize);
+        return syncToDisk(file_);
+    }
+
+    const QByteArray all = file_.readAll();
+    const uchar* p = reinterpret_cast<const uchar*>(all.constData());
+    if (qFromLittleEndian<quint32>(p) != kMagic || qFromLittleEndian<quint16>(p + 4) != kVersion) {
+        file_.close();
+        return false;
+    }
+
+    qint64 good = kHeaderSize;
+    for (qint64 off = kHeaderSize; off + kRecordSize <= all.size(); off += kRecordSize) {
+        const uchar* r = p + off;
+        if (fnv1a(r, kRecordSize - 4) != qFromLittleEndian<quint32>(r + 28)) break;
+        Record rec;
+        rec.seq    = qFromLittleEndian<quint64>(r);
+        rec.op     = Op(r[8]);
+        rec.userId = qFromLittleEndian<qint32>(r + 12);
+        rec.itemId = qFromLittleEndian<qint32>(r + 16);
+        const qint64 due = qFromLittleEndian<qint64>(r + 20);
+        if (due != kNoDay) rec.due = QDate::fromJulianDay(due);
+        if (rec.seq < nextSeq_) break;   // sequence must only grow
+        nextSeq_ = rec.seq + 1;
+        if (records) records->append(rec);
+        good = off + kRecordSize;
+    }
+
+    // Cut off a partially written tail so new records land after valid ones.
+    if (good != all.size() && !file_.resize(good)) return false;
+    return file_.seek(good);
+}
+
+void Journal::close() {
+    stopFlusher();
+    if (!file_.isOpen()) return;
+    commit();
+    QMutexLocker io(&io_);
+    file_.close();
+}
+
+bool Journal::append(Op op, int userId, int itemId, const QDate& due) {
+    {
+        QMutexLocker lock(&lock_);
+        uchar r[kRecordSize] = {};
+        qToLittleEndian<quint64>(nextSeq_++, r);
+        r[8] = op;
+        qToLittleEndian<qint32>(userId, r + 12);
+        qToLittleEndian<qint32>(itemId, r + 16);
+        qToLittleEndian<qint64>(due.isValid() ? due.toJulianDay() : kNoDay, r + 20);
+        qToLittleEndian<quint32>(fnv1a(r, kRecordSize - 4), r + 28);
+        buffer_.append(reinterpret_cast<const char*>(r), kRecordSize);
+        if (++pending_ < groupSize_) return true;
+        if (flusher_.joinable()) {
+            if (!failing_) wake_.wakeOne();   // while failing it retries on its interval
+            return true;
+        }
+    }
+    return commit();
+}
+
+// The buffer is swapped out under lock_ and written under io_ alone, so
+// appends carry on into a fresh buffer meanwhile. On failure the group is put
+// back in front of them and whatever part of it reached the file is cut off
+// again, so the retry doesn't write it twice.
+bool Journal::commit() {
+    QMutexLocker io(&io_);
+    QByteArray group;
+    int count;
+    {
+        QMutexLocker lock(&lock_);
+        if (!pending_ || !file_.isOpen()) return true;
+        group.swap(buffer_);
+        count = pending_;
+        pending_ = 0;
+    }
+    const qint64 at = file_.pos();
+    const bool ok = file_.write(group) == group.size() && syncToDisk(file_);
+    QString error;
+    if (!ok) {
+        error = file_.errorString();
+        file_.resize(at);
+        file_.seek(at);
+    }
+
+    QString failure;
+    {
+        QMutexLocker lock(&lock_);
+        if (ok) {
+            failing_ = false;
+        } else {
+            buffer_.prepend(group);
+            pending_ += count;
+            error_ = error;
+            if (!failing_) failure = error;
+            failing_ = true;
+        }
+    }
+    failed(failure);
+    return ok;
+}
+
+int Journal::pending() const {
+    QMutexLocker lock(&lock_);
+    return pending_;
+}
+
+void Journal::startFlusher(int intervalMs) {
+    stopFlusher();
+    intervalMs_ = qMax(1, intervalMs);
+    stopping_ = false;
+    flusher_ = std::thread(&Journal::flushLoop, this);
+}
+
+void Journal::stopFlusher() {
+    if (!flusher_.joinable()) return;
+    {
+        QMutexLocker lock(&lock_);
+        stopping_ = true;
+        wake_.wakeAll();
+    }
+    flusher_.join();
+}
+
+void Journal::flushLoop() {
+    QMutexLocker lock(&lock_);
+    while (!stopping_) {
+        if (pending_ < groupSize_ || failing_) wake_.wait(&lock_, intervalMs_);
+        if (stopping_ || !pending_) continue;
+        lock.unlock();
+        commit();
+        lock.relock();
+    }
+}
+
+QString Journal::lastError() const {
+    QMutexLocker lock(&lock_);
+    return error_;
+}
+
+bool Journal::truncate() {
+    QMutexLocker io(&io_);
+    if (!file_.isOpen()) return false;
+    {
+        QMutexLocker lock(&lock_);
+        buffer_.clear();
+        pending_ = 0;
+        failing_ = false;
+    }
+    return file_.resize(kHeaderSize) && file_.seek(kHeaderSize) && syncToDisk(file_);
+}
@@ -0,0 +1,91 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QDate>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include <thread>
+
+class QFileDevice;
+
+// flush() plus fsync so the bytes survive a crash, not just a process exit.
+bool syncToDisk(QFileDevice& f);
+
+// Append-only log of successful LibraryController commands. Records are
+// buffered and written + fsync'd in groups, so a burst of checkouts pays
+// for one sync instead of one per operation. append/commit may be called
+// from different threads; the write and fsync happen outside the lock
+// append() takes, so appends never wait for the disk. A group that fails to
+// reach the disk stays buffered and goes out with the next commit.
+class Journal {
+public:
+    enum Op : quint8 { Borrow = 1, Return = 2, PlaceHold = 3, CancelHold = 4 };
+
+    struct Record {
+        quint64 seq = 0;
+        Op op = Borrow;
+        int userId = -1;
+        int itemId = -1;
+        QDate due;         // Borrow: due date; Return/CancelHold: pickup deadline, if any
+    };
+
+    Journal() = default;
+    ~Journal();
+
+    // Opens (creating if needed) and validates the log; a torn tail left by
+    // a crash is cut off. Valid records are returned through 'records'.
+    bool open(const QString& path, QList<Record>* records = nullptr);
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+
+    // False if the commit it set off failed (the record is kept, see above).
+    bool append(Op op, int userId, int itemId, const QDate& due = QDate());
+    bool commit();        // write pending records and fsync
+    bool truncate();      // drop everything (after a checkpoint)
+
+    // Called once when commits start failing, with the error, on the thread
+    // that committed; again only after one has succeeded. Set before sharing.
+    typedef std::function<void(const QString& error)> FailureHandler;
+    void setFailureHandler(const FailureHandler& fn) { onFailure_ = fn; }
+    QString lastError() const;
+
+    // Records buffered before append() forces a commit on its own.
+    void setGroupSize(int n) { groupSize_ = n > 0 ? n : 1; }
+    int  pending() const;
+
+    // Commits on a background thread every intervalMs, and as soon as a
+    // group fills, instead of in append(). close() stops it.
+    void startFlusher(int intervalMs);
+    void stopFlusher();
+
+    quint64 lastSeq() const { return nextSeq_ - 1; }
+    void    setLastSeq(quint64 seq) { if (seq >= nextSeq_) nextSeq_ = seq + 1; }
+
+private:
+    Q_DISABLE_COPY(Journal)
+    void flushLoop();
+    void failed(const QString& error) const { if (!error.isEmpty() && onFailure_) onFailure_(error); }
+
+    mutable QMutex lock_;   // buffer, counters, error state
+    QMutex io_;             // the file; taken before lock_, never after
+
+    QFile file_;
+    QByteArray buffer_;
+    int pending_ = 0;
+    int groupSize_ = 64;
+    quint64 nextSeq_ = 1;
+    bool failing_ = false;
+    QString error_;
+    FailureHandler onFailure_;
+
+    std::thread flusher_;
+    QWaitCondition wake_;
+    int intervalMs_ = 0;
+    bool stopping_ = false;
+};
+
+#endif // JOURNAL_H
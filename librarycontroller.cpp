@@ -1,10 +1,27 @@
 #include "librarycontroller.h"
 #include "catalogue.h"
+#include "cataloguesnapshot.h"
 #include "item.h"
 #include "user.h"
+#include "journal.h"
+#include "itempolicy.h"
+#include "metrics.h"
 #include <QDate>
+#include <QMutexLocker>
+#include <algorithm>
 
-LibraryController::LibraryController(Catalogue* cat) : cat_(cat) {}
+static_assert(LibraryController::kLoanDays == StandardLoanTerms::kLoanDays, "standard loan period");
+
+LibraryController::LibraryController(Catalogue* cat, int shards)
+    : cat_(cat), userLocks_(shards), itemLocks_(shards)
+{
+    rescheduleAll();
+}
+
+void LibraryController::setClock(const Clock* clock) {
+    clock_ = clock ? clock : SystemClock::instance();
+    rescheduleAll();
+}
 
 Item* LibraryController::findItem(int id) const {
     return cat_ ? cat_->findItem(id) : 0;
@@ -13,10 +30,8 @@ User* LibraryController::findUser(int id) const {
     return cat_ ? cat_->findUserById(id) : 0;
 }
 
-// ---------------------- Queries ----------------------
-Result LibraryController::canBorrow(int userId, int itemId) const {
-    Item* it = findItem(itemId);
-    User* u  = findUser(userId);
+// ---------------------- Rules ----------------------
+Result LibraryController::checkBorrow(const Item* it, const User* u, const CatalogueSnapshot* snap) const {
     if (!it || !u) return Result(false, "Invalid selection.");
 
     if (it->status != Availability::Available)
@@ -25,15 +40,26 @@ Result LibraryController::canBorrow(int userId, int itemId) const {
     if (u->loans.size() >= kMaxLoans)
         return Result(false, "Maximum of 3 active loans reached.");
 
+    // Per-type caps only bite when tighter than the overall one.
+    const ItemTypeInfo& terms = itemTypeInfo(it->type);
+    if (terms.maxLoans < kMaxLoans) {
+        int ofType = 0;
+        for (int id : u->loans) {
+            const Item* other = snap ? snap->findItem(id) : findItem(id);
+            if (other && other->type == it->type) ++ofType;
+        }
+        if (ofType >= terms.maxLoans)
+            return Result(false, QString("Maximum of %1 %2 loans reached.").arg(terms.maxLoans).arg(terms.name));
+    }
+
     // If a queue exists, only first-in-line can check out.
-    if (!it->holdQueue.isEmpty() && it->holdQueue.first() != userId)
+    if (!it->holdQueue.isEmpty() && it->holdQueue.first() != u->id)
         return Result(false, "Another patron is first in the hold queue.");
 
     return Result(true);
 }
 
-Result LibraryController::canReturn(int userId, int itemId) const {
-    Item* it = findItem(itemId);
+Result LibraryController::checkReturn(const Item* it, int userId) const {
     if (!it) return Result(false, "Invalid selection.");
 
     if (it->status == Availability::Available)
@@ -45,8 +71,7 @@ Result LibraryController::canReturn(int userId, int itemId) const {
     return Result(true);
 }
 
-Result LibraryController::canPlaceHold(int userId, int itemId) const {
-    Item* it = findItem(itemId);
+Result LibraryController::checkPlaceHold(const Item* it, int userId) const {
     if (!it) return Result(false, "Invalid selection.");
 
     if (it->status != Availability::CheckedOut)
@@ -58,8 +83,7 @@ Result LibraryController::canPlaceHold(int userId, int itemId) const {
     return Result(true);
 }
 
-Result LibraryController::canCancelHold(int userId, int itemId) const {
-    Item* it = findItem(itemId);
+Result LibraryController::checkCancelHold(const Item* it, int userId) const {
     if (!it) return Result(false, "Invalid selection.");
 
     if (!it->holdQueue.contains(userId))
@@ -68,7 +92,88 @@ Result LibraryController::canCancelHold(int userId, int itemId) const {
     return Result(true);
 }
 
+void LibraryController::finish(int op, int userId, const Item* it) {
+    cat_->touchCirculation(it->id, userId);
+    {
+        QMutexLocker side(concurrent() ? &sideLock_ : nullptr);
+        scheduleLocked(*it);
+    }
+    if (journal_) journal_->append(Journal::Op(op), userId, it->id, op == Journal::Borrow ? it->due : it->pickupBy);
+}
+
+// The first holder of an available item has kPickupDays from reaching the
+// front. The deadline lives on the item, so a restart or a clock switch
+// doesn't restart the window.
+void LibraryController::startPickup(Item* it) const {
+    const bool waiting = it->status == Availability::Available && !it->holdQueue.isEmpty();
+    it->pickupBy = waiting ? today().addDays(kPickupDays) : QDate();
+}
+
+// A checked-out item has a loan timer; an available one with holders has a
+// pickup timer for its first holder, due at the item's pickupBy.
+void LibraryController::scheduleLocked(const Item& it) {
+    if (it.status == Availability::CheckedOut) {
+        due_.cancel(DueScheduler::HoldPickup, it.id);
+        due_.schedule(DueScheduler::LoanDue, it.id, it.borrowerId, it.due);
+        return;
+    }
+    due_.cancel(DueScheduler::LoanDue, it.id);
+    if (it.holdQueue.isEmpty()) {
+        due_.cancel(DueScheduler::HoldPickup, it.id);
+        return;
+    }
+    due_.schedule(DueScheduler::HoldPickup, it.id, it.holdQueue.first(),
+                  it.pickupBy.isValid() ? it.pickupBy : today().addDays(kPickupDays));
+}
+
+// ---------------------- Queries ----------------------
+Result LibraryController::canBorrow(int userId, int itemId) const {
+    HL_TIMED(CanBorrow);
+    QMutexLocker userLock(userLocks_.forId(userId));
+    QMutexLocker itemLock(itemLocks_.forId(itemId));
+    return checkBorrow(findItem(itemId), findUser(userId));
+}
+
+Result LibraryController::canReturn(int userId, int itemId) const {
+    HL_TIMED(CanReturn);
+    QMutexLocker userLock(userLocks_.forId(userId));
+    QMutexLocker itemLock(itemLocks_.forId(itemId));
+    return checkReturn(findItem(itemId), userId);
+}
+
+Result LibraryController::canPlaceHold(int userId, int itemId) const {
+    HL_TIMED(CanPlaceHold);
+    QMutexLocker userLock(userLocks_.forId(userId));
+    QMutexLocker itemLock(itemLocks_.forId(itemId));
+    return checkPlaceHold(findItem(itemId), userId);
+}
+
+Result LibraryController::canCancelHold(int userId, int itemId) const {
+    HL_TIMED(CanCancelHold);
+    QMutexLocker userLock(userLocks_.forId(userId));
+    QMutexLocker itemLock(itemLocks_.forId(itemId));
+    return checkCancelHold(findItem(itemId), userId);
+}
+
+Result LibraryController::canBorrow(const CatalogueSnapshot& snap, int userId, int itemId) const {
+    return checkBorrow(snap.findItem(itemId), snap.findUserById(userId), &snap);
+}
+
+Result LibraryController::canReturn(const CatalogueSnapshot& snap, int userId, int itemId) const {
+    return checkReturn(snap.findItem(itemId), userId);
+}
+
+Result LibraryController::canPlaceHold(const CatalogueSnapshot& snap, int userId, int itemId) const {
+    return checkPlaceHold(snap.findItem(itemId), userId);
+}
+
+Result LibraryController::canCancelHold(const CatalogueSnapshot& snap, int userId, int itemId) const {
+    return checkCancelHold(snap.findItem(itemId), userId);
+}
+
 int LibraryController::queuePosition(int userId, int itemId) const {
+    HL_TIMED(QueuePosition);
+    QMutexLocker itemLock(itemLocks_.forId(itemId));
     Item* it = findItem(itemId);
     if (!it) return -1;
     int idx = it->holdQueue.indexOf(userId);
@@ -76,61 +181,198 @@ int LibraryController::queuePosition(int userId, int itemId) const {
 }
 
 // ---------------------- Commands ----------------------
-Result LibraryController::borrow(int userId, int itemId) {
-    Result chk = canBorrow(userId, itemId);
+// Each command checks and mutates under the same locks, so the check can't
+// go stale between canX() and the write.
+Result LibraryController::applyBorrow(Item* it, User* u, int userId, ChangeSet& changes) {
+    Result chk = checkBorrow(it, u);
     if (!chk.ok) return chk;
 
-    Item* it = findItem(itemId);
-    User* u  = findUser(userId);
-
     it->status = Availability::CheckedOut;
     it->borrowerId = userId;
-    it->due = QDate::currentDate().addDays(14);
-    u->addLoan(it->id);
+    it->due = today().addDays(itemTypeInfo(it->type).loanDays);
+    it->pickupBy = QDate();
+    cat_->link(Relation::Loan, userId, it->id);
 
     // If user was first in queue, pop & clear their hold record.
     if (!it->holdQueue.isEmpty() && it->holdQueue.first() == userId) {
         it->holdQueue.pop_front();
-        u->removeHold(it->id);
+        cat_->unlink(Relation::Hold, userId, it->id);
+        changes.holdItems.append(it->id);
+        changes.holdUsers.append(userId);
     }
+    finish(Journal::Borrow, userId, it);
+    changes.items.append(it->id);
+    changes.loanUsers.append(userId);
     return Result(true, "Borrowed.");
 }
 
-Result LibraryController::returnItem(int userId, int itemId) {
-    Result chk = canReturn(userId, itemId);
+Result LibraryController::applyReturn(Item* it, User*, int userId, ChangeSet& changes) {
+    Result chk = checkReturn(it, userId);
     if (!chk.ok) return chk;
 
-    Item* it = findItem(itemId);
-    User* u  = findUser(userId);
-
     it->status = Availability::Available;
     it->borrowerId = -1;
     it->due = QDate();
-    u->removeLoan(it->id);
+    startPickup(it);
+    cat_->unlink(Relation::Loan, userId, it->id);
+    finish(Journal::Return, userId, it);
+    changes.items.append(it->id);
+    changes.loanUsers.append(userId);
     return Result(true, "Returned.");
 }
 
-Result LibraryController::placeHold(int userId, int itemId) {
-    Result chk = canPlaceHold(userId, itemId);
+Result LibraryController::applyPlaceHold(Item* it, User*, int userId, ChangeSet& changes) {
+    Result chk = checkPlaceHold(it, userId);
     if (!chk.ok) return chk;
 
-    Item* it = findItem(itemId);
-    User* u  = findUser(userId);
-
     it->holdQueue.append(userId);
-    u->addHold(it->id);
+    cat_->link(Relation::Hold, userId, it->id);
+    finish(Journal::PlaceHold, userId, it);
+    changes.holdItems.append(it->id);
+    changes.holdUsers.append(userId);
     int pos = it->holdQueue.size();
     return Result(true, QString("Hold placed. You are #%1.").arg(pos), pos);
 }
 
-Result LibraryController::cancelHold(int userId, int itemId) {
-    Result chk = canCancelHold(userId, itemId);
+Result LibraryController::applyCancelHold(Item* it, User*, int userId, ChangeSet& changes) {
+    Result chk = checkCancelHold(it, userId);
     if (!chk.ok) return chk;
 
-    Item* it = findItem(itemId);
-    User* u  = findUser(userId);
-
+    const bool wasFirst = it->holdQueue.first() == userId;
     it->holdQueue.removeAll(userId);
-    u->removeHold(it->id);
+    if (wasFirst) startPickup(it);   // the next holder's window starts now
+    cat_->unlink(Relation::Hold, userId, it->id);
+    finish(Journal::CancelHold, userId, it);
+    changes.holdItems.append(it->id);
+    changes.holdUsers.append(userId);
     return Result(true, "Hold canceled.");
 }
+
+Result LibraryController::runOne(Apply fn, int userId, int itemId) {
+    Result r;
+    ChangeSet changes;
+    {
+        QMutexLocker userLock(userLocks_.forId(userId));
+        QMutexLocker itemLock(itemLocks_.forId(itemId));
+        r = (this->*fn)(findItem(itemId), findUser(userId), userId, changes);
+    }
+    notify(changes);
+    return r;
+}
+
+QVector<Result> LibraryController::runBatch(Apply fn, const QVector<CirculationOp>& ops) {
+    // Resolve every record in one pass; slots don't move while circulating.
+    const int n = ops.size();
+    QVector<Item*> items(n);
+    QVector<User*> users(n);
+    for (int i = 0; i < n; ++i) {
+        items[i] = findItem(ops.at(i).itemId);
+        users[i] = findUser(ops.at(i).userId);
+    }
+
+    QVector<Result> out;
+    out.reserve(n);
+    ChangeSet changes;
+    for (int i = 0; i < n; ++i) {
+        const CirculationOp& op = ops.at(i);
+        QMutexLocker userLock(userLocks_.forId(op.userId));
+        QMutexLocker itemLock(itemLocks_.forId(op.itemId));
+        out.append((this->*fn)(items.at(i), users.at(i), op.userId, changes));
+    }
+    notify(changes);
+    return out;
+}
+
+int LibraryController::subscribe(const ChangeListener& fn) {
+    listeners_.append(qMakePair(nextToken_, fn));
+    return nextToken_++;
+}
+
+void LibraryController::unsubscribe(int token) {
+    for (int i = 0; i < listeners_.size(); ++i)
+        if (listeners_.at(i).first == token) { listeners_.removeAt(i); return; }
+}
+
+void LibraryController::notify(ChangeSet changes) const {
+    if (listeners_.isEmpty() || changes.isEmpty()) return;
+    changes.normalize();
+    for (const auto& l : listeners_) l.second(changes);
+}
+
+Result LibraryController::borrow(int userId, int itemId) {
+    HL_TIMED(Borrow);
+    return runOne(&LibraryController::applyBorrow, userId, itemId);
+}
+Result LibraryController::returnItem(int userId, int itemId) {
+    HL_TIMED(Return);
+    return runOne(&LibraryController::applyReturn, userId, itemId);
+}
+Result LibraryController::placeHold(int userId, int itemId) {
+    HL_TIMED(PlaceHold);
+    return runOne(&LibraryController::applyPlaceHold, userId, itemId);
+}
+Result LibraryController::cancelHold(int userId, int itemId) {
+    HL_TIMED(CancelHold);
+    return runOne(&LibraryController::applyCancelHold, userId, itemId);
+}
+
+QVector<Result> LibraryController::borrowBatch(const QVector<CirculationOp>& ops) {
+    HL_TIMED(BorrowBatch);
+    return runBatch(&LibraryController::applyBorrow, ops);
+}
+QVector<Result> LibraryController::returnBatch(const QVector<CirculationOp>& ops) {
+    HL_TIMED(ReturnBatch);
+    return runBatch(&LibraryController::applyReturn, ops);
+}
+QVector<Result> LibraryController::placeHoldBatch(const QVector<CirculationOp>& ops) {
+    HL_TIMED(PlaceHoldBatch);
+    return runBatch(&LibraryController::applyPlaceHold, ops);
+}
+QVector<Result> LibraryController::cancelHoldBatch(const QVector<CirculationOp>& ops) {
+    HL_TIMED(CancelHoldBatch);
+    return runBatch(&LibraryController::applyCancelHold, ops);
+}
+
+// ---------------------- Due dates ----------------------
+QVector<DueScheduler::Event> LibraryController::runDueEvents() {
+    HL_TIMED(RunDueEvents);
+    QVector<DueScheduler::Event> fired;
+    {
+        QMutexLocker side(concurrent() ? &sideLock_ : nullptr);
+        fired = due_.advanceTo(today());
+    }
+
+    ChangeSet changes;
+    for (const auto& ev : fired) {
+        if (ev.kind != DueScheduler::HoldPickup) continue;
+        QMutexLocker userLock(userLocks_.forId(ev.userId));
+        QMutexLocker itemLock(itemLocks_.forId(ev.itemId));
+        // Picked up or cancelled since the timer was set? Then nothing lapsed.
+        Item* it = findItem(ev.itemId);
+        if (!it || it->status != Availability::Available || it->holdQueue.isEmpty()
+                || it->holdQueue.first() != ev.userId)
+            continue;
+        applyCancelHold(it, findUser(ev.userId), ev.userId, changes);
+    }
+    notify(changes);
+    return fired;
+}
+
+QVector<DueScheduler::Event> LibraryController::overdueLoans() const {
+    QMutexLocker side(concurrent() ? &sideLock_ : nullptr);
+    return due_.overdue();
+}
+
+void LibraryController::rescheduleAll() {
+    QMutexLocker side(concurrent() ? &sideLock_ : nullptr);
+    due_ = DueScheduler(today());
+    if (!cat_) return;
+    for (auto& it : cat_->items) {
+        // Loaded without a deadline (an older snapshot): the window starts now.
+        if (it.status == Availability::Available && !it.holdQueue.isEmpty() && !it.pickupBy.isValid()) {
+            it.pickupBy = today().addDays(kPickupDays);
+            cat_->touchCirculation(it.id);
+        }
+        scheduleLocked(it);
+    }
+}
@@ -2,11 +2,21 @@
 #define LIBRARYCONTROLLER_H
 
 #include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QPair>
+#include <functional>
+#include "lockstripes.h"
+#include "clock.h"
+#include "duescheduler.h"
+#include "changeset.h"
 
 // Forward-declare your entities to keep header light.
 class Catalogue;
 struct Item;    // from item.h (struct with public fields)
 class User;     // from user.h
+class Journal;  // from journal.h
+class CatalogueSnapshot;
 
 // Tiny UI-friendly result.
 struct Result {
@@ -16,9 +26,36 @@ struct Result {
     Result(bool o=false, const QString& m=QString(), int a=0) : ok(o), message(m), aux(a) {}
 };
 
+// One (user, item) pair of a batch call.
+struct CirculationOp {
+    int userId;
+    int itemId;
+    CirculationOp(int u=-1, int i=-1) : userId(u), itemId(i) {}
+};
+
+// With shards > 0 the controller is safe to share between threads (e.g.
+// several circulation desks): users and items hash onto striped mutexes and
+// every call holds its user's stripe, then its item's, for its duration.
+// Taking them in that fixed order means two calls can never deadlock.
 class LibraryController {
 public:
-    explicit LibraryController(Catalogue* cat);
+    explicit LibraryController(Catalogue* cat, int shards = 0);
+    bool concurrent() const { return itemLocks_.enabled(); }
+
+    // Successful commands are appended here when set (see CatalogueStore).
+    void setJournal(Journal* journal) { journal_ = journal; }
+
+    // Where "today" comes from; defaults to the system clock. Not owned.
+    // Switching clocks rebuilds the due index (see rescheduleAll).
+    void setClock(const Clock* clock);
+    QDate today() const { return clock_->today(); }
+
+    // Every subscriber is called once per command, or once per batch, that
+    // changed something, on the calling thread after all locks are released.
+    // Subscribe before sharing the controller between threads.
+    typedef std::function<void(const ChangeSet& changes)> ChangeListener;
+    int  subscribe(const ChangeListener& fn);   // returns a token
+    void unsubscribe(int token);
 
     // --- Queries (no mutation) ---
     Result canBorrow(int userId, int itemId) const;
@@ -27,18 +64,90 @@ public:
     Result canCancelHold(int userId, int itemId) const;
     int    queuePosition(int userId, int itemId) const;
 
+    // The same rules against a snapshot, taking no locks: for showing what
+    // is allowed (e.g. enabling buttons) while commands run. The answer may
+    // be stale; the command itself checks again.
+    Result canBorrow(const CatalogueSnapshot& snap, int userId, int itemId) const;
+    Result canReturn(const CatalogueSnapshot& snap, int userId, int itemId) const;
+    Result canPlaceHold(const CatalogueSnapshot& snap, int userId, int itemId) const;
+    Result canCancelHold(const CatalogueSnapshot& snap, int userId, int itemId) const;
+
     // --- Commands (mutate state) ---
-    Result borrow(int userId, int itemId);      // due = today + 14
+    Result borrow(int userId, int itemId);      // due = today + the type's loan days
     Result returnItem(int userId, int itemId);
     Result placeHold(int userId, int itemId);   // aux = queue pos
     Result cancelHold(int userId, int itemId);
 
+    // --- Batch commands: one Result per op, in order; one change notice ---
+    QVector<Result> borrowBatch(const QVector<CirculationOp>& ops);
+    QVector<Result> returnBatch(const QVector<CirculationOp>& ops);
+    QVector<Result> placeHoldBatch(const QVector<CirculationOp>& ops);
+    QVector<Result> cancelHoldBatch(const QVector<CirculationOp>& ops);
+
+    // --- Due dates ---
+    // Loans are due after their item type's loan period (ItemPolicy; the
+    // standard kLoanDays for every type today). When a returned item has a
+    // hold queue, the first holder has kPickupDays to borrow it before their
+    // hold lapses and the next holder's window starts.
+    static const int kLoanDays = 14;
+    static const int kPickupDays = 7;
+
+    // Advances the due index to today(), cancels lapsed pickup holds and
+    // returns every loan that became overdue or hold that expired since the
+    // last call (e.g. to send notices). Call periodically.
+    QVector<DueScheduler::Event> runDueEvents();
+
+    // Loans reported overdue by runDueEvents() and not yet returned.
+    QVector<DueScheduler::Event> overdueLoans() const;
+
+    // Rebuild the due index from the catalogue; call after loading or
+    // editing items directly. Pickup windows keep their Item::pickupBy; one
+    // missing it (e.g. loaded from an older snapshot) starts today().
+    void rescheduleAll();
+
 private:
+    Q_DISABLE_COPY(LibraryController)
+
     Item* findItem(int id) const;
     User* findUser(int id) const;
 
+    // Rule checks on already-resolved (and, if concurrent, locked) records.
+    // checkBorrow looks the user's other loans up in `snap` if given.
+    Result checkBorrow(const Item* it, const User* u, const CatalogueSnapshot* snap = nullptr) const;
+    Result checkReturn(const Item* it, int userId) const;
+    Result checkPlaceHold(const Item* it, int userId) const;
+    Result checkCancelHold(const Item* it, int userId) const;
+
+    // Check + mutate on resolved records; the caller holds the locks.
+    // Each records what it changed in `changes`.
+    Result applyBorrow(Item* it, User* u, int userId, ChangeSet& changes);
+    Result applyReturn(Item* it, User* u, int userId, ChangeSet& changes);
+    Result applyPlaceHold(Item* it, User* u, int userId, ChangeSet& changes);
+    Result applyCancelHold(Item* it, User* u, int userId, ChangeSet& changes);
+
+    typedef Result (LibraryController::*Apply)(Item*, User*, int, ChangeSet&);
+    Result runOne(Apply fn, int userId, int itemId);
+    QVector<Result> runBatch(Apply fn, const QVector<CirculationOp>& ops);
+
+    // Shared tail of every successful command: refresh derived catalogue
+    // structures and journal it. Runs under the command's stripe locks; only
+    // the due index is shared, under sideLock_, and the journal only buffers.
+    void finish(int op, int userId, const Item* it);
+    void notify(ChangeSet changes) const;
+    void scheduleLocked(const Item& it);   // caller holds sideLock_
+    void startPickup(Item* it) const;      // sets it->pickupBy from its queue
+
     static const int kMaxLoans = 3;
     Catalogue* cat_;
+    Journal* journal_ = nullptr;
+    QVector<QPair<int, ChangeListener>> listeners_;
+    int nextToken_ = 1;
+    const Clock* clock_ = SystemClock::instance();
+    DueScheduler due_;
+
+    LockStripes userLocks_;
+    LockStripes itemLocks_;
+    mutable QMutex sideLock_;
 };
 
 #endif // LIBRARYCONTROLLER_H
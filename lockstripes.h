@@ -0,0 +1,23 @@
+#ifndef LOCKSTRIPES_H
+#define LOCKSTRIPES_H
+
+#include <QMutex>
+
+// Fixed pool of mutexes that ids hash onto. A count of 0 disables locking:
+// forId() then returns nullptr, which QMutexLocker treats as a no-op.
+class LockStripes {
+public:
+    explicit LockStripes(int count = 0) : n_(count > 0 ? count : 0), locks_(n_ ? new QMutex[n_] : nullptr) {}
+    ~LockStripes() { delete[] locks_; }
+
+    bool enabled() const { return n_ > 0; }
+    int  count() const { return n_; }
+    QMutex* forId(int id) const { return n_ ? &locks_[quint32(id) % quint32(n_)] : nullptr; }
+
+private:
+    Q_DISABLE_COPY(LockStripes)
+    int n_;
+    QMutex* locks_;
+};
+
+#endif // LOCKSTRIPES_H
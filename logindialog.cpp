@@ -1,6 +1,11 @@
 #include "logindialog.h"
 #include <QHBoxLayout>
 
+static const int kSuggestions = 8;
+// Lookups ask for this many, so a few staff among the matches still leave
+// kSuggestions patrons.
+static const int kLookups = 2 * kSuggestions;
+
 LoginDialog::LoginDialog(Catalogue* cat, QWidget* parent)
     : QDialog(parent), cat_(cat)
 {
@@ -9,6 +14,9 @@ LoginDialog::LoginDialog(Catalogue* cat, QWidget* parent)
     auto* label  = new QLabel("Enter your name (e.g., Alice, Bob, Carmen, Diego, Eva, Liam, Sara):", this);
     nameEdit_ = new QLineEdit(this);
     nameEdit_->setPlaceholderText("Name");
+    suggestions_ = new QListWidget(this);
+    suggestions_->setMaximumHeight(140);
+    suggestions_->setVisible(false);
     msg_ = new QLabel(this);
     msg_->setStyleSheet("color:#a00;");
 
@@ -21,20 +29,57 @@ LoginDialog::LoginDialog(Catalogue* cat, QWidget* parent)
 
     layout->addWidget(label);
     layout->addWidget(nameEdit_);
+    layout->addWidget(suggestions_);
     layout->addWidget(msg_);
     layout->addLayout(btns);
 
     connect(ok, &QPushButton::clicked, this, &LoginDialog::onAccept);
     connect(cancel, &QPushButton::clicked, this, &LoginDialog::reject);
+    connect(nameEdit_, &QLineEdit::textEdited, this, &LoginDialog::onTextEdited);
+    connect(suggestions_, &QListWidget::itemActivated, this, &LoginDialog::onSuggestionChosen);
     nameEdit_->setFocus();
 }
 
 void LoginDialog::onAccept() {
     auto* u = cat_->findUserByName(nameEdit_->text());
+    const auto picked = suggestions_->selectedItems();
+    if (!u && !picked.isEmpty()) u = cat_->findUserById(picked.first()->data(Qt::UserRole).toInt());
     if (!u) {
-        msg_->setText("User not found. Try one of the seeded names.");
+        const QVector<int> like = cat_->usersNamedLike(nameEdit_->text(), 2, kLookups);
+        showSuggestions(like);
+        msg_->setText(like.isEmpty() ? "User not found. Try one of the seeded names."
+                                     : "User not found. Did you mean one of these?");
         return;
     }
     selectedId_ = u->id;
     accept();
 }
+
+// Completions as they type; typo matches once there's enough to go on.
+void LoginDialog::onTextEdited(const QString& text) {
+    msg_->clear();
+    QVector<int> ids = cat_->usersByNamePrefix(text, kLookups);
+    const int typed = NameIndex::normalize(text).size();
+    if (ids.isEmpty() && typed >= 3) ids = cat_->usersNamedLike(text, typed <= 5 ? 1 : 2, kLookups);
+    showSuggestions(ids);
+}
+
+void LoginDialog::onSuggestionChosen(QListWidgetItem* item) {
+    selectedId_ = item->data(Qt::UserRole).toInt();
+    accept();
+}
+
+// A suggestion signs in with one click, so on a shared (self-checkout)
+// terminal it must never offer a staff account, or say who is staff. Staff
+// sign in by typing their full name.
+void LoginDialog::showSuggestions(const QVector<int>& userIds) {
+    suggestions_->clear();
+    for (int id : userIds) {
+        const User* u = cat_->findUserById(id);
+        if (!u || u->type != UserType::Patron) continue;
+        auto* row = new QListWidgetItem(u->name, suggestions_);
+        row->setData(Qt::UserRole, id);
+        if (suggestions_->count() == kSuggestions) break;
+    }
+    suggestions_->setVisible(suggestions_->count() > 0);
+}
@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QLabel>
 #include <QLineEdit>
+#include <QListWidget>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include "catalogue.h"
@@ -16,10 +17,15 @@ public:
 
 private slots:
     void onAccept();
+    void onTextEdited(const QString& text);
+    void onSuggestionChosen(QListWidgetItem* item);
 
 private:
+    void showSuggestions(const QVector<int>& userIds);
+
     Catalogue* cat_;
     QLineEdit* nameEdit_;
+    QListWidget* suggestions_;   // autocomplete / "did you mean"
     QLabel*    msg_;
     int selectedId_ = -1;
 };
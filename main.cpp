@@ -6,6 +6,7 @@ int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
     MainWindow w;
+    if (!w.loaded()) return 1;
     w.show();
     return a.exec();  // ← fixed
 }
@@ -9,21 +9,101 @@
 #include <QHBoxLayout>
 #include <QSplitter>
 #include <QToolBar>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QFileDialog>
+#include <QMetaObject>
+#include <algorithm>
+#include "cataloguecsv.h"
+#include "itempolicy.h"
+#include "metrics.h"
+#include "reportengine.h"
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
 {
-    cat_.seedDefaultData();
-    lib_ = new LibraryController(&cat_);  // controller uses in-memory data
+    // Concurrent: commands run on exec_'s workers while the GUI thread queries.
+    lib_ = new LibraryController(&cat_, 64);
+
+    // Restore the last snapshot + journal; first run starts from the demo data.
+    store_ = new CatalogueStore(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    if (!store_->exists()) {
+        cat_.seedDefaultData();
+        if (!store_->checkpoint(cat_))
+            QMessageBox::warning(nullptr, "HinLIBS", "Changes will not be saved:\n" + store_->lastError());
+    } else if (!store_->open(cat_, *lib_)) {
+        // Never seed over a catalogue we couldn't read; leave the files be.
+        QMessageBox::critical(nullptr, "HinLIBS", QString("Could not load the catalogue in %1:\n%2")
+                              .arg(store_->directory(), store_->lastError()));
+        return;
+    }
+    loaded_ = true;
+    // Commits failing (disk full, I/O error): the records stay buffered and
+    // are retried, but say so once rather than let loans look saved.
+    store_->journal()->setFailureHandler([this](const QString& error) {
+        QMetaObject::invokeMethod(this, [this, error]{
+            QMessageBox::warning(this, "HinLIBS", "Recent changes could not be saved to disk; "
+                                 "they will be retried.\n\n" + error);
+        }, Qt::QueuedConnection);
+    });
+    lib_->setJournal(store_->journal());
+
+    // Learns loan lengths from here on; replayed journal loans would skew it.
+    forecast_.attach(lib_);
+    views_.setForecast(&forecast_);
+
+    // Controller changes arrive coalesced, once per event-loop pass.
+    bus_ = new ChangeBus(this);
+    bus_->attach(lib_);
+    connect(bus_, &ChangeBus::changed, this, &MainWindow::onChanged);
+
+    exec_ = new CommandExecutor(lib_);
+
+    // Group commit a few times a second, on the journal's thread: an fsync
+    // on this one would stall painting.
+    store_->journal()->startFlusher(200);
+
+    // Overdue loans and lapsed hold pickups, run on exec_ like any command;
+    // expiries refresh via the change notice.
+    auto* due = new QTimer(this);
+    // Also catches the date rolling over, which changes every "days left".
+    connect(due, &QTimer::timeout, this, [this]{
+        exec_->submit(Command(Command::DueEvents));
+        if (active_ && views_.isStale(active_->id, lib_->today())) refreshAccountPanels();
+    });
+    due->start(60 * 1000);
+
     buildUi();
     loginFlow();
 }
 
+MainWindow::~MainWindow() {
+    delete exec_;   // finishes queued commands
+    lib_->setJournal(nullptr);
+    if (loaded_) store_->checkpoint(cat_);
+    // HINLIBS_METRICS=path.json (or .prom) keeps this session's timings.
+    const QString metrics = qEnvironmentVariable("HINLIBS_METRICS");
+    if (!metrics.isEmpty()) Metrics::writeTo(metrics);
+    delete store_;
+    delete lib_;
+}
+
 void MainWindow::buildUi() {
     setWindowTitle("HinLIBS");
     auto* tool = addToolBar("Main");
     auto* actLogout = tool->addAction("Logout");
     connect(actLogout, &QAction::triggered, this, &MainWindow::onLogout);
+    // Bulk holdings (CSV); staff only, see setActiveUser()
+    actImport_ = tool->addAction("Import CSV...");
+    actExport_ = tool->addAction("Export CSV...");
+    actImport_->setEnabled(false);
+    actExport_->setEnabled(false);
+    connect(actImport_, &QAction::triggered, this, &MainWindow::importCatalogue);
+    connect(actExport_, &QAction::triggered, this, &MainWindow::exportCatalogue);
+    // Circulation statistics; admins only
+    actReports_ = tool->addAction("Reports...");
+    actReports_->setEnabled(false);
+    connect(actReports_, &QAction::triggered, this, &MainWindow::showReports);
 
     auto* central = new QWidget(this);
     auto* root = new QVBoxLayout(central);
@@ -32,14 +112,29 @@ void MainWindow::buildUi() {
     banner_->setObjectName("banner");
     banner_->setStyleSheet("#banner{font-weight:600;font-size:16px;padding:8px 4px;}");
 
-    // Items table
-    itemsTbl_ = new QTableWidget(this);
-    itemsTbl_->setColumnCount(8);
-    itemsTbl_->setHorizontalHeaderLabels({"ID","Title","Creator","Type","Status","Due","Extra 1","Extra 2"});
-    itemsTbl_->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    itemsTbl_->setSelectionBehavior(QAbstractItemView::SelectRows);
-    itemsTbl_->setSelectionMode(QAbstractItemView::SingleSelection);
-    connect(itemsTbl_->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::onSelectionChanged);
+    // Search box: filters the items view as the user types
+    search_ = new QLineEdit(this);
+    search_->setPlaceholderText("Search title, creator, genre, Dewey or issue");
+    search_->setClearButtonEnabled(true);
+    connect(search_, &QLineEdit::textChanged, this, &MainWindow::onSearchChanged);
+    searchTimer_ = new QTimer(this);
+    searchTimer_->setSingleShot(true);
+    searchTimer_->setInterval(150);
+    connect(searchTimer_, &QTimer::timeout, this, &MainWindow::applySearch);
+
+    // Items table (model/view over cat_.items)
+    itemsModel_ = new ItemTableModel(&cat_, this);
+    itemsProxy_ = new ItemSortProxy(itemsModel_, this);
+    itemsView_ = new QTableView(this);
+    itemsView_->setModel(itemsProxy_);
+    itemsView_->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    itemsView_->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    itemsView_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    itemsView_->setSelectionMode(QAbstractItemView::SingleSelection);
+    itemsView_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    itemsView_->setSortingEnabled(true);
+    itemsView_->sortByColumn(ItemTableModel::ColId, Qt::AscendingOrder);
+    connect(itemsView_->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::onSelectionChanged);
 
     // Actions
     auto* actions = new QHBoxLayout();
@@ -88,8 +183,8 @@ void MainWindow::buildUi() {
     loansTbl_->setEditTriggers(QAbstractItemView::NoEditTriggers);
 
     holdsTbl_ = new QTableWidget(this);
-    holdsTbl_->setColumnCount(2);
-    holdsTbl_->setHorizontalHeaderLabels({"Title","Queue Pos"});
+    holdsTbl_->setColumnCount(3);
+    holdsTbl_->setHorizontalHeaderLabels({"Title","Queue Pos","Expected"});
     holdsTbl_->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     holdsTbl_->setEditTriggers(QAbstractItemView::NoEditTriggers);
 
@@ -97,7 +192,8 @@ void MainWindow::buildUi() {
     acctLay->addWidget(holdsTbl_, 1);
 
     root->addWidget(banner_);
-    root->addWidget(itemsTbl_, 3);
+    root->addWidget(search_);
+    root->addWidget(itemsView_, 3);
     root->addLayout(actions);
     root->addWidget(detBox);
     root->addWidget(acctBox, 2);
@@ -128,6 +224,9 @@ void MainWindow::setActiveUser(int uid) {
     btnReturn_->setEnabled(patron);
     btnHold_->setEnabled(patron);
     btnCancelHold_->setEnabled(patron);
+    actImport_->setEnabled(!patron);
+    actExport_->setEnabled(!patron);
+    actReports_->setEnabled(active_->type == UserType::Admin);
 }
 
 void MainWindow::refreshAll() {
@@ -137,79 +236,42 @@ void MainWindow::refreshAll() {
     updateButtons();
 }
 
-static int selectedItemId(const QTableWidget* tbl) {
-    auto sel = tbl->selectionModel()->selectedRows();
-    if (sel.isEmpty()) return -1;
-    return tbl->item(sel.first().row(), 0)->text().toInt();
+// Controller change notice: only those rows, and the panels showing them,
+// can differ.
+void MainWindow::onChanged(const ChangeSet& changes) {
+    itemsModel_->itemsChanged(changes.items);
+    // Rows still waiting on a command: re-apply it to what is there now.
+    for (auto p = inFlight_.constBegin(); p != inFlight_.constEnd(); ++p)
+        if (ChangeSet::has(changes.items, p.key()) || ChangeSet::has(changes.holdItems, p.key())) showPending(p.key());
+
+    const int sel = selectedItemId();
+    const bool selected = ChangeSet::has(changes.items, sel) || ChangeSet::has(changes.holdItems, sel);
+    if (ChangeSet::has(changes.items, sel)) refreshDetails();
+
+    // Queue positions shift for everyone behind a change, so the views also
+    // mark holds on items whose queue moved, not just holds we placed.
+    views_.invalidate(changes);
+    const bool mine = active_ && views_.isStale(active_->id, lib_->today());
+    if (mine) refreshAccountPanels();
+    if (mine || selected) updateButtons();
 }
 
-QString MainWindow::extra1Header(ItemType t) {
-    switch (t) {
-        case ItemType::NonFiction: return "Dewey";
-        case ItemType::Magazine:   return "Issue";
-        case ItemType::Movie:      return "Genre";
-        case ItemType::VideoGame:  return "Genre";
-        default: return "Extra 1";
-    }
-}
-QString MainWindow::extra2Header(ItemType t) {
-    switch (t) {
-        case ItemType::Magazine:   return "Published";
-        case ItemType::Movie:      return "Rating";
-        case ItemType::VideoGame:  return "Rating";
-        default: return "Extra 2";
-    }
-}
-QString MainWindow::extra1Value(const Item& it) {
-    switch (it.type) {
-        case ItemType::NonFiction: return it.dewey;
-        case ItemType::Magazine:   return it.issue;
-        case ItemType::Movie:
-        case ItemType::VideoGame:  return it.genre;
-        default: return "";
-    }
-}
-QString MainWindow::extra2Value(const Item& it) {
-    switch (it.type) {
-        case ItemType::Magazine:   return it.pub.isValid() ? it.pub.toString("yyyy-MM-dd") : "";
-        case ItemType::Movie:
-        case ItemType::VideoGame:  return it.rating;
-        default: return "";
-    }
+int MainWindow::selectedItemId() const {
+    auto sel = itemsView_->selectionModel()->selectedRows();
+    if (sel.isEmpty()) return -1;
+    return sel.first().data(ItemTableModel::ItemIdRole).toInt();
 }
 
 void MainWindow::refreshItemsTable() {
-    itemsTbl_->setRowCount(0);
-    itemsTbl_->clearContents();
-    itemsTbl_->setSortingEnabled(false);
-
-    itemsTbl_->setHorizontalHeaderLabels({"ID","Title","Creator","Type","Status","Due","Extra 1","Extra 2"});
-
-    int row=0;
-    for (const auto& it : cat_.items) {
-        itemsTbl_->insertRow(row);
-        auto put = [&](int col, const QString& s){
-            auto* item = new QTableWidgetItem(s);
-            if (col==0) item->setData(Qt::UserRole, it.id);
-            item->setFlags(item->flags() ^ Qt::ItemIsEditable);
-            itemsTbl_->setItem(row, col, item);
-        };
-        put(0, QString::number(it.id));
-        put(1, it.title);
-        put(2, it.creator);
-        put(3, toString(it.type));
-        put(4, toString(it.status));
-        put(5, it.due.isValid()? it.due.toString("yyyy-MM-dd") : "");
-        put(6, extra1Value(it));
-        put(7, extra2Value(it));
-        row++;
-    }
-    itemsTbl_->setSortingEnabled(true);
+    HL_TIMED(RefreshItems);
+    itemsModel_->reload();
 }
 
 void MainWindow::refreshDetails() {
-    int id = selectedItemId(itemsTbl_);
-    const Item* it = (id>=0) ? cat_.findItem(id) : nullptr;
+    HL_TIMED(RefreshDetails);
+    // As of the last change notice, like the table row it describes.
+    int id = selectedItemId();
+    const Item* it = (id>=0) ? itemsModel_->snapshot().findItem(id) : nullptr;
     if (!it) {
         detTitle_->setText("Title: -");
         detCreator_->setText("Creator: -");
@@ -220,6 +282,12 @@ void MainWindow::refreshDetails() {
         detExtra2_->setText("Extra 2: -");
         return;
     }
+    // Commands still running on it: show what they should leave, as the
+    // table row does, until their completion shows what they did.
+    Item expected;
+    const bool pending = expectedItem(id, expected);
+    if (pending) it = &expected;
+
     detTitle_->setText("Title: " + it->title);
     detCreator_->setText("Creator: " + it->creator);
     detType_->setText("Type: " + toString(it->type));
@@ -227,106 +295,295 @@ void MainWindow::refreshDetails() {
     detDue_->setText("Due: " + (it->due.isValid()? it->due.toString("yyyy-MM-dd") : "-"));
     detExtra1_->setText(extra1Header(it->type) + ": " + extra1Value(*it));
     detExtra2_->setText(extra2Header(it->type) + ": " + extra2Value(*it));
+
+    if (!pending) return;
+    switch (inFlight_.value(id).last().kind) {
+        case Command::Borrow:
+        case Command::Return:
+        case Command::DueEvents:
+            detStatus_->setText(detStatus_->text() + " (pending)");
+            break;
+        case Command::PlaceHold:
+            detStatus_->setText(detStatus_->text() + ", hold pending");
+            break;
+        case Command::CancelHold:
+            detStatus_->setText(detStatus_->text() + ", cancelling hold");
+            break;
+    }
+}
+
+// Rewrites a cell only when its text differs, so a refresh that changed one
+// row doesn't rebuild the others.
+static void setCell(QTableWidget* tbl, int r, int c, const QString& text) {
+    QTableWidgetItem* cell = tbl->item(r, c);
+    if (!cell) {
+        cell = new QTableWidgetItem(text);
+        cell->setFlags(cell->flags() & ~Qt::ItemIsEditable);
+        tbl->setItem(r, c, cell);
+    } else if (cell->text() != text) {
+        cell->setText(text);
+    }
 }
 
 void MainWindow::refreshAccountPanels() {
-    loansTbl_->setRowCount(0);
-    holdsTbl_->setRowCount(0);
-    if (!active_) return;
+    HL_TIMED(RefreshAccounts);
+    if (!active_) {
+        loansTbl_->setRowCount(0);
+        holdsTbl_->setRowCount(0);
+        return;
+    }
+    // From the table's snapshot: no lock, so a running command can't stall it.
+    const CatalogueSnapshot& snap = itemsModel_->snapshot();
+    const QDate today = lib_->today();
+    QVector<LoanRow> loans = views_.loans(snap, active_->id, today);
+    QVector<HoldRow> holds = views_.holds(snap, active_->id, today);
+
+    // Our commands in flight: add or drop their rows as they should, marked
+    // pending. Their completion repaints from the snapshot, which undoes
+    // any that failed.
+    for (auto p = inFlight_.constBegin(); p != inFlight_.constEnd(); ++p) {
+        bool mine = false;
+        for (const Command& cmd : p.value()) mine = mine || cmd.userId == active_->id;
+        Item it;
+        if (!mine || !expectedItem(p.key(), it)) continue;
+
+        auto loan = std::find_if(loans.begin(), loans.end(), [&](const LoanRow& r){ return r.itemId == it.id; });
+        const bool borrowed = it.status == Availability::CheckedOut && it.borrowerId == active_->id;
+        if (borrowed && loan == loans.end()) {
+            LoanRow row;
+            row.itemId = it.id;
+            row.title = it.title + " (pending)";
+            row.due = it.due;
+            row.daysLeft = int(today.daysTo(it.due));
+            loans.append(row);
+        } else if (!borrowed && loan != loans.end()) {
+            loans.erase(loan);
+        }
+
+        auto hold = std::find_if(holds.begin(), holds.end(), [&](const HoldRow& r){ return r.itemId == it.id; });
+        const int idx = it.holdQueue.indexOf(active_->id);
+        if (idx >= 0 && hold == holds.end()) {
+            HoldRow row;
+            row.itemId = it.id;
+            row.title = it.title + " (pending)";
+            row.position = idx + 1;
+            row.expected = forecast_.expected(it, row.position, today);
+            holds.append(row);
+        } else if (idx < 0 && hold != holds.end()) {
+            holds.erase(hold);
+        }
+    }
 
     // Loans
-    int r=0;
-    for (int itemId : active_->loans) {
-        const Item* it = cat_.findItem(itemId);
-        if (!it) continue;
-        loansTbl_->insertRow(r);
-        auto put=[&](int c, const QString&s){
-            auto* cell=new QTableWidgetItem(s);
-            cell->setFlags(cell->flags() ^ Qt::ItemIsEditable);
-            loansTbl_->setItem(r,c,cell);
-        };
-        put(0, it->title);
-        put(1, it->due.isValid()? it->due.toString("yyyy-MM-dd") : "");
-        int daysLeft = QDate::currentDate().daysTo(it->due);
-        put(2, QString::number(daysLeft));
-        r++;
+    loansTbl_->setRowCount(loans.size());
+    for (int r = 0; r < loans.size(); ++r) {
+        const LoanRow& row = loans.at(r);
+        setCell(loansTbl_, r, 0, row.title);
+        setCell(loansTbl_, r, 1, row.due.isValid() ? row.due.toString("yyyy-MM-dd") : QString());
+        setCell(loansTbl_, r, 2, QString::number(row.daysLeft));
     }
 
     // Holds
-    r=0;
-    for (int itemId : active_->holds) {
-        const Item* it = cat_.findItem(itemId);
-        if (!it) continue;
-        int pos = it->holdQueue.indexOf(active_->id);
-        holdsTbl_->insertRow(r);
-        auto put=[&](int c, const QString&s){
-            auto* cell=new QTableWidgetItem(s);
-            cell->setFlags(cell->flags() ^ Qt::ItemIsEditable);
-            holdsTbl_->setItem(r,c,cell);
-        };
-        put(0, it->title);
-        put(1, (pos>=0? QString::number(pos+1) : "-"));
-        r++;
+    holdsTbl_->setRowCount(holds.size());
+    for (int r = 0; r < holds.size(); ++r) {
+        const HoldRow& row = holds.at(r);
+        setCell(holdsTbl_, r, 0, row.title);
+        setCell(holdsTbl_, r, 1, row.position > 0 ? QString::number(row.position) : "-");
+        setCell(holdsTbl_, r, 2, row.expected.isValid() ? row.expected.toString("yyyy-MM-dd") : "-");
     }
 }
 
 void MainWindow::updateButtons() {
+    HL_TIMED(UpdateButtons);
     const bool patron = active_ && active_->type == UserType::Patron;
-    int id = selectedItemId(itemsTbl_);
+    int id = selectedItemId();
 
     bool canBorrow=false, canReturn=false, canHold=false, canCancelHold=false;
 
+    // Against the snapshot, taking no locks; a stale answer only means the
+    // command fails and its optimistic update rolls back.
     if (patron && id >= 0 && lib_) {
-        canBorrow     = lib_->canBorrow(active_->id, id).ok;
-        canReturn     = lib_->canReturn(active_->id, id).ok;
-        canHold       = lib_->canPlaceHold(active_->id, id).ok;
-        canCancelHold = lib_->canCancelHold(active_->id, id).ok;
+        const CatalogueSnapshot& snap = itemsModel_->snapshot();
+        canBorrow     = lib_->canBorrow(snap, active_->id, id).ok;
+        canReturn     = lib_->canReturn(snap, active_->id, id).ok;
+        canHold       = lib_->canPlaceHold(snap, active_->id, id).ok;
+        canCancelHold = lib_->canCancelHold(snap, active_->id, id).ok;
     }
 
-    btnBorrow_->setEnabled(canBorrow);
-    btnReturn_->setEnabled(canReturn);
-    btnHold_->setEnabled(canHold);
-    btnCancelHold_->setEnabled(canCancelHold);
+    // A button stays disabled while its command on this item is in flight.
+    btnBorrow_->setEnabled(canBorrow && !inFlight(id, Command::Borrow));
+    btnReturn_->setEnabled(canReturn && !inFlight(id, Command::Return));
+    btnHold_->setEnabled(canHold && !inFlight(id, Command::PlaceHold));
+    btnCancelHold_->setEnabled(canCancelHold && !inFlight(id, Command::CancelHold));
 }
 
-void MainWindow::borrowItem() {
-    if (!active_ || active_->type != UserType::Patron || !lib_) return;
-    int id = selectedItemId(itemsTbl_);
-    if (id < 0) return;
+void MainWindow::borrowItem()  { submit(Command::Borrow); }
+void MainWindow::returnItem()  { submit(Command::Return); }
+void MainWindow::placeHold()   { submit(Command::PlaceHold); }
+void MainWindow::cancelHold()  { submit(Command::CancelHold); }
+
+bool MainWindow::inFlight(int itemId, Command::Kind kind) const {
+    const auto pending = inFlight_.constFind(itemId);
+    if (pending == inFlight_.constEnd()) return false;
+    for (const Command& cmd : *pending)
+        if (cmd.kind == kind) return true;
+    return false;
+}
 
-    Result r = lib_->borrow(active_->id, id);
-    if (!r.ok) QMessageBox::warning(this,"Borrow", r.message);
-    refreshAll();
+// Each command as it would succeed. Its completion may lag the change
+// notice, so one already in the snapshot must apply as a no-op.
+bool MainWindow::expectedItem(int itemId, Item& out) const {
+    const auto pending = inFlight_.constFind(itemId);
+    if (pending == inFlight_.constEnd()) return false;
+    const Item* it = itemsModel_->snapshot().findItem(itemId);
+    if (!it) return false;
+    out = *it;
+    for (const Command& cmd : *pending) {
+        switch (cmd.kind) {
+            case Command::Borrow:
+                if (out.status == Availability::CheckedOut) break;
+                out.status = Availability::CheckedOut;
+                out.borrowerId = cmd.userId;
+                out.due = lib_->today().addDays(itemTypeInfo(out.type).loanDays);
+                out.pickupBy = QDate();
+                if (!out.holdQueue.isEmpty() && out.holdQueue.first() == cmd.userId) out.holdQueue.pop_front();
+                break;
+            case Command::Return:
+                out.status = Availability::Available;
+                out.borrowerId = -1;
+                out.due = QDate();
+                break;
+            case Command::PlaceHold:
+                if (!out.holdQueue.contains(cmd.userId)) out.holdQueue.append(cmd.userId);
+                break;
+            case Command::CancelHold:
+                out.holdQueue.removeAll(cmd.userId);
+                break;
+            case Command::DueEvents:
+                break;
+        }
+    }
+    return true;
 }
 
-void MainWindow::returnItem() {
-    if (!active_ || active_->type != UserType::Patron || !lib_) return;
-    int id = selectedItemId(itemsTbl_);
-    if (id < 0) return;
+void MainWindow::showPending(int itemId) {
+    Item expected;
+    if (expectedItem(itemId, expected)) itemsModel_->setPending(expected);
+    else                                itemsModel_->clearPending(itemId);
+}
 
-    Result r = lib_->returnItem(active_->id, id);
-    if (!r.ok) QMessageBox::warning(this, "Return", r.message);
-    refreshAll();
+// Queues the command and shows its expected outcome at once; the user may
+// go on to other items (or other commands on this one) meanwhile.
+void MainWindow::submit(Command::Kind kind) {
+    if (!active_ || active_->type != UserType::Patron || !exec_) return;
+    int id = selectedItemId();
+    if (id < 0 || inFlight(id, kind)) return;
+
+    Command cmd(kind, active_->id, id);
+    cmd.ticket = exec_->submit(cmd, [this](const Command& done, const Result& r) {
+        QMetaObject::invokeMethod(this, [this, done, r]{ onCommandDone(done, r); }, Qt::QueuedConnection);
+    });
+    inFlight_[id].append(cmd);
+    showPending(id);
+    refreshDetails();
+    refreshAccountPanels();
+    updateButtons();
 }
 
-void MainWindow::placeHold() {
-    if (!active_ || active_->type != UserType::Patron || !lib_) return;
-    int id = selectedItemId(itemsTbl_);
-    if (id < 0) return;
+void MainWindow::onCommandDone(const Command& cmd, const Result& r) {
+    auto pending = inFlight_.find(cmd.itemId);
+    if (pending != inFlight_.end()) {
+        for (int i = 0; i < pending->size(); ++i) {
+            if (pending->at(i).ticket == cmd.ticket) { pending->remove(i); break; }
+        }
+        if (pending->isEmpty()) inFlight_.erase(pending);
+    }
+    // A success also arrives as a change notice; after a failure this rolls
+    // the row, details and panels back from the optimistic update to what
+    // is really there.
+    showPending(cmd.itemId);
+    if (cmd.itemId == selectedItemId()) refreshDetails();
+    updateButtons();
 
-    Result r = lib_->placeHold(active_->id, id);
-    QMessageBox::information(this, "Hold", r.message);
-    refreshAll();
+    if (!active_ || active_->id != cmd.userId) return;   // signed out since
+    refreshAccountPanels();
+    switch (cmd.kind) {
+        case Command::Borrow:     if (!r.ok) QMessageBox::warning(this, "Borrow", r.message); break;
+        case Command::Return:     if (!r.ok) QMessageBox::warning(this, "Return", r.message); break;
+        case Command::PlaceHold:  QMessageBox::information(this, "Hold", r.message); break;
+        case Command::CancelHold: if (!r.ok) QMessageBox::warning(this, "Cancel hold", r.message); break;
+        case Command::DueEvents:  break;
+    }
 }
 
-void MainWindow::cancelHold() {
-    if (!active_ || active_->type != UserType::Patron || !lib_) return;
-    int id = selectedItemId(itemsTbl_);
-    if (id < 0) return;
+void MainWindow::importCatalogue() {
+    if (!active_ || active_->type == UserType::Patron) return;
+    const QString path = QFileDialog::getOpenFileName(this, "Import holdings", QString(), "CSV files (*.csv);;All files (*)");
+    if (path.isEmpty()) return;
+
+    ImportReport rep;
+    QString error;
+    bool ok, saved = true;
+    {
+        // Adds rows commands may be walking; none runs until it's in.
+        CommandExecutor::Pause pause(exec_);
+        ok = CatalogueCsv::importFile(cat_, path, &rep, &error);
+        // New items aren't journaled; a checkpoint makes them durable.
+        if (ok && rep.imported) saved = store_->checkpoint(cat_);
+    }
+    if (!ok) {
+        QMessageBox::warning(this, "Import", error);
+        return;
+    }
+    if (!saved)
+        QMessageBox::warning(this, "Import", "The imported items could not be saved to disk; they "
+                             "are lost if HinLIBS stops before a later save succeeds.\n\n" + store_->lastError());
+    views_.clear();
+    refreshItemsTable();
+    lastSearch_.clear();   // new rows: filter them all again
+    applySearch();
 
-    Result r = lib_->cancelHold(active_->id, id);
-    if (!r.ok) QMessageBox::warning(this, "Cancel hold", r.message);
-    refreshAll();
+    QString msg = QString("Imported %1 items, rejected %2.").arg(rep.imported).arg(rep.rejected);
+    if (!rep.errors.isEmpty()) msg += "\n\n" + rep.errors.mid(0, 10).join("\n");
+    QMessageBox::information(this, "Import", msg);
+}
+
+void MainWindow::exportCatalogue() {
+    if (!active_ || active_->type == UserType::Patron) return;
+    const QString path = QFileDialog::getSaveFileName(this, "Export holdings", "holdings.csv", "CSV files (*.csv)");
+    if (path.isEmpty()) return;
+
+    QString error;
+    bool ok;
+    {
+        CommandExecutor::Pause pause(exec_);
+        ok = CatalogueCsv::exportFile(cat_, path, &error);
+    }
+    if (!ok) QMessageBox::warning(this, "Export", error);
+}
+
+void MainWindow::showReports() {
+    if (!active_ || active_->type != UserType::Admin) return;
+    const ReportTable table = ReportTable::from(cat_.snapshot());
+    const ReportEngine engine;
+
+    QStringList lines;
+    lines << "Loans per type:";
+    for (const auto& row : engine.run(table, ReportQuery::loansPerType()))
+        lines << QString("  %1: %2").arg(toString(ItemType(row.key))).arg(row.value);
+
+    lines << "" << "Longest hold queues:";
+    for (const auto& row : engine.run(table, ReportQuery::longestHoldQueues(10))) {
+        const Item* it = cat_.findItem(int(row.key));
+        lines << QString("  %1: %2 waiting").arg(it ? it->title : QString::number(row.key)).arg(row.value);
+    }
+
+    lines << "" << "Overdue by patron:";
+    for (const auto& row : engine.run(table, ReportQuery::overdueByPatron(lib_->today(), 10))) {
+        const User* u = cat_.findUserById(int(row.key));
+        lines << QString("  %1: %2 overdue").arg(u ? u->name : QString::number(row.key)).arg(row.value);
+    }
+    QMessageBox::information(this, "Reports", lines.join("\n"));
 }
 
 void MainWindow::onSelectionChanged() {
@@ -334,11 +591,36 @@ void MainWindow::onSelectionChanged() {
     updateButtons();
 }
 
+// Typing: look up once the keys pause, not on every one.
+void MainWindow::onSearchChanged(const QString&) {
+    searchTimer_->start();
+}
+
+void MainWindow::applySearch() {
+    searchTimer_->stop();
+    // Circulation leaves the search index alone (touchCirculation), so
+    // commands keep running while this looks it up. A query that only grew
+    // matches a subset of the last one's hits, so those are narrowed.
+    const QString text = search_->text();
+    if (text.trimmed().isEmpty())
+        itemsProxy_->clearIdFilter();
+    else if (!lastSearch_.trimmed().isEmpty() && text.startsWith(lastSearch_))
+        itemsProxy_->narrowIdFilter(cat_.search(text));
+    else
+        itemsProxy_->setIdFilter(cat_.search(text));
+    lastSearch_ = text;
+    refreshDetails();
+    updateButtons();
+}
+
 void MainWindow::onLogout() {
     active_ = nullptr;
     banner_->setText("Not signed in");
     loansTbl_->setRowCount(0);
     holdsTbl_->setRowCount(0);
+    actImport_->setEnabled(false);
+    actExport_->setEnabled(false);
+    actReports_->setEnabled(false);
     updateButtons();
     loginFlow();
 }
@@ -3,19 +3,33 @@
 
 #include <QMainWindow>
 #include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
 #include <QLabel>
 #include <QGroupBox>
 #include <QAction>
+#include <QLineEdit>
+#include <QTimer>
 
 #include "catalogue.h"
 #include "logindialog.h"
 #include "librarycontroller.h"   // <-- added
+#include "itemtablemodel.h"
+#include "cataloguestore.h"
+#include "changebus.h"
+#include "accountview.h"
+#include "availabilityforecast.h"
+#include "commandexecutor.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 public:
     explicit MainWindow(QWidget* parent=nullptr);
+    ~MainWindow() override;
+
+    // False if the stored catalogue couldn't be read; the window is not set
+    // up then, and the app should exit.
+    bool loaded() const { return loaded_; }
 
 private slots:
     // Actions
@@ -23,9 +37,14 @@ private slots:
     void returnItem();
     void placeHold();
     void cancelHold();
+    void importCatalogue();
+    void exportCatalogue();
+    void showReports();
 
     // UI events
     void onSelectionChanged();
+    void onSearchChanged(const QString& text);
+    void applySearch();
     void onLogout();
 
 private:
@@ -35,27 +54,53 @@ private:
     void setActiveUser(int uid);
 
     void refreshAll();
+    void onChanged(const ChangeSet& changes);
     void refreshItemsTable();
     void refreshDetails();
     void refreshAccountPanels();
     void updateButtons();
+    int  selectedItemId() const;
 
-    // Helpers for extra columns/labels
-    static QString extra1Header(ItemType t);
-    static QString extra2Header(ItemType t);
-    static QString extra1Value(const Item& it);
-    static QString extra2Value(const Item& it);
+    // Circulation commands run on exec_; the buttons don't wait for them.
+    void submit(Command::Kind kind);
+    void onCommandDone(const Command& cmd, const Result& r);
+    bool inFlight(int itemId, Command::Kind kind) const;
+    // The item as the commands in flight on it should leave it; false if
+    // none are, or it isn't in the snapshot.
+    bool expectedItem(int itemId, Item& out) const;
+    void showPending(int itemId);   // table row: expected item, or the real one
 
     // Data
     Catalogue cat_;
     User* active_ = nullptr;
 
+    // Cached rows of the account panels, per user
+    AccountViews views_;
+    AvailabilityForecast forecast_{&cat_};
+
     // Controller (option a: entities remain public)
     LibraryController* lib_ = nullptr;   // <-- added
 
+    // Worker threads for circulation commands
+    CommandExecutor* exec_ = nullptr;
+    QHash<int, QVector<Command>> inFlight_;   // item id -> submitted, not yet completed
+
+    // Snapshot + journal persistence
+    CatalogueStore* store_ = nullptr;
+    bool loaded_ = false;
+
+    // Coalesced change notices from lib_
+    ChangeBus* bus_ = nullptr;
+
     // Widgets
     QLabel* banner_ = nullptr;
-    QTableWidget* itemsTbl_ = nullptr;
+    QLineEdit* search_ = nullptr;
+    QTimer* searchTimer_ = nullptr;   // debounces search_
+    QString lastSearch_;              // the query itemsProxy_ filters by
+    QTableView* itemsView_ = nullptr;
+    ItemTableModel* itemsModel_ = nullptr;
+    ItemSortProxy* itemsProxy_ = nullptr;
+    QAction *actImport_ = nullptr, *actExport_ = nullptr, *actReports_ = nullptr;
     QPushButton *btnBorrow_ = nullptr, *btnReturn_ = nullptr, *btnHold_ = nullptr, *btnCancelHold_ = nullptr;
 
     // Details
@@ -0,0 +1,250 @@
+#include "metrics.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtAlgorithms>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const int kSubBits = 4;                          // 16 sub-buckets per power of two
+const int kSub = 1 << kSubBits;
+const int kMaxExp = 39;                          // values up to 2^40 ns
+const int kBuckets = (kMaxExp - kSubBits + 2) * kSub;
+
+int bucketOf(quint64 v) {
+    if (v < quint64(kSub)) return int(v);
+    const int e = 63 - qCountLeadingZeroBits(v);
+    if (e > kMaxExp) return kBuckets - 1;
+    const int sub = int((v >> (e - kSubBits)) & (kSub - 1));
+    return (e - kSubBits + 1) * kSub + sub;
+}
+
+// Largest value that lands in bucket b.
+quint64 bucketTop(int b) {
+    if (b < kSub) return quint64(b);
+    const int e = b / kSub + kSubBits - 1;
+    const quint64 low = quint64(kSub + b % kSub) << (e - kSubBits);
+    return low + (quint64(1) << (e - kSubBits)) - 1;
+}
+
+// Each counter has one writer (its thread); a relaxed load + store is
+// enough and, unlike fetch_add, needs no locked instruction.
+typedef std::atomic<quint64> Cell;
+inline void bump(Cell& c, quint64 by) { c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed); }
+
+struct Histogram {
+    Cell count{0}, sum{0}, max{0};
+    Cell buckets[kBuckets];
+    Histogram() { for (auto& b : buckets) b.store(0, std::memory_order_relaxed); }
+    void clear() {
+        count.store(0); sum.store(0); max.store(0);
+        for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    }
+};
+
+struct Shard {
+    Histogram h[Metrics::MetricCount];
+};
+
+// Every shard ever handed out, live or parked. A thread that exits folds
+// its shard into retired_ and parks it for the next thread to reuse, so
+// short-lived threads neither lose their numbers nor grow the list.
+struct Registry {
+    QMutex lock;
+    QVector<Shard*> live;
+    QVector<Shard*> spare;
+    Shard retired;
+};
+
+Registry& registry() {
+    static Registry* r = new Registry;   // never destroyed: threads may outlive statics
+    return *r;
+}
+
+void fold(Histogram& into, const Histogram& from) {
+    bump(into.count, from.count.load(std::memory_order_relaxed));
+    bump(into.sum, from.sum.load(std::memory_order_relaxed));
+    const quint64 m = from.max.load(std::memory_order_relaxed);
+    if (m > into.max.load(std::memory_order_relaxed)) into.max.store(m, std::memory_order_relaxed);
+    for (int b = 0; b < kBuckets; ++b) {
+        const quint64 n = from.buckets[b].load(std::memory_order_relaxed);
+        if (n) bump(into.buckets[b], n);
+    }
+}
+
+struct ThreadShard {
+    Shard* shard = nullptr;
+    ~ThreadShard() {
+        if (!shard) return;
+        Registry& r = registry();
+        QMutexLocker locker(&r.lock);
+        for (int m = 0; m < Metrics::MetricCount; ++m) {
+            fold(r.retired.h[m], shard->h[m]);
+            shard->h[m].clear();
+        }
+        r.live.removeOne(shard);
+        r.spare.append(shard);
+    }
+};
+
+thread_local ThreadShard tls;
+
+Shard* shard() {
+    if (Q_LIKELY(tls.shard)) return tls.shard;
+    Registry& r = registry();
+    QMutexLocker locker(&r.lock);
+    tls.shard = r.spare.isEmpty() ? new Shard : r.spare.takeLast();
+    r.live.append(tls.shard);
+    return tls.shard;
+}
+
+const char* const kNames[Metrics::MetricCount] = {
+    "can_borrow", "can_return", "can_place_hold", "can_cancel_hold", "queue_position",
+    "borrow", "return", "place_hold", "cancel_hold",
+    "borrow_batch", "return_batch", "place_hold_batch", "cancel_hold_batch",
+    "run_due_events",
+    "find_item", "find_user", "slot_scan",
+    "search", "browse",
+    "refresh_items", "refresh_details", "refresh_accounts", "update_buttons"
+};
+
+} // namespace
+
+const char* Metrics::name(Metric m) { return kNames[m]; }
+
+bool Metrics::timed(Metric m) { return m != FindItem && m != FindUser && m != SlotScan; }
+
+void Metrics::record(Metric m, qint64 ns) {
+    Histogram& h = shard()->h[m];
+    const quint64 v = ns > 0 ? quint64(ns) : 0;
+    bump(h.count, 1);
+    bump(h.sum, v);
+    if (v > h.max.load(std::memory_order_relaxed)) h.max.store(v, std::memory_order_relaxed);
+    bump(h.buckets[bucketOf(v)], 1);
+}
+
+void Metrics::count(Metric m) {
+    bump(shard()->h[m].count, 1);
+}
+
+// Not atomic with respect to threads recording at the same moment; a few
+// samples may survive the reset.
+void Metrics::reset() {
+    Registry& r = registry();
+    QMutexLocker locker(&r.lock);
+    for (Shard* s : r.live)
+        for (auto& h : s->h) h.clear();
+    for (auto& h : r.retired.h) h.clear();
+}
+
+Metrics::Summary Metrics::summary(Metric m) {
+    Histogram merged;
+    {
+        Registry& r = registry();
+        QMutexLocker locker(&r.lock);
+        for (Shard* s : r.live) fold(merged, s->h[m]);
+        fold(merged, r.retired.h[m]);
+    }
+
+    Summary out;
+    out.count = merged.count.load();
+    out.sumNs = merged.sum.load();
+    out.maxNs = merged.max.load();
+    if (!timed(m) || out.count == 0) return out;
+
+    // Bucket counts and count are read separately while threads record,
+    // so walk against the buckets' own total.
+    quint64 total = 0;
+    for (const auto& b : merged.buckets) total += b.load();
+    struct { double p; quint64* into; } wanted[] = {
+        { 0.50, &out.p50Ns }, { 0.90, &out.p90Ns }, { 0.99, &out.p99Ns }, { 0.999, &out.p999Ns }
+    };
+    quint64 seen = 0;
+    int w = 0;
+    for (int b = 0; b < kBuckets && w < 4; ++b) {
+        seen += merged.buckets[b].load();
+        while (w < 4 && seen >= qMax<quint64>(1, quint64(std::ceil(wanted[w].p * total)))) {
+            *wanted[w].into = qMin(bucketTop(b), out.maxNs);
+            ++w;
+        }
+    }
+    return out;
+}
+
+QByteArray Metrics::toJson() {
+    QJsonArray list;
+    for (int i = 0; i < MetricCount; ++i) {
+        const Metric m = Metric(i);
+        const Summary s = summary(m);
+        QJsonObject o;
+        o["name"] = name(m);
+        o["count"] = double(s.count);
+        if (timed(m)) {
+            o["sum_ns"] = double(s.sumNs);
+            o["max_ns"] = double(s.maxNs);
+            o["p50_ns"] = double(s.p50Ns);
+            o["p90_ns"] = double(s.p90Ns);
+            o["p99_ns"] = double(s.p99Ns);
+            o["p999_ns"] = double(s.p999Ns);
+        }
+        list.append(o);
+    }
+    QJsonObject root;
+    root["metrics"] = list;
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+// Prometheus text exposition format: timed operations as summaries (the
+// quantiles come from the histograms), lookups as counters.
+QByteArray Metrics::toPrometheus() {
+    QByteArray out;
+    auto line = [&out](const char* fmt, const char* op, double v) {
+        char buf[160];
+        snprintf(buf, sizeof buf, fmt, op, v);
+        out += buf;
+    };
+
+    out += "# HELP hinlibs_op_duration_seconds Latency of library operations.\n"
+           "# TYPE hinlibs_op_duration_seconds summary\n";
+    for (int i = 0; i < MetricCount; ++i) {
+        const Metric m = Metric(i);
+        if (!timed(m)) continue;
+        const Summary s = summary(m);
+        line("hinlibs_op_duration_seconds{op=\"%s\",quantile=\"0.5\"} %.9f\n",   name(m), s.p50Ns / 1e9);
+        line("hinlibs_op_duration_seconds{op=\"%s\",quantile=\"0.9\"} %.9f\n",   name(m), s.p90Ns / 1e9);
+        line("hinlibs_op_duration_seconds{op=\"%s\",quantile=\"0.99\"} %.9f\n",  name(m), s.p99Ns / 1e9);
+        line("hinlibs_op_duration_seconds{op=\"%s\",quantile=\"0.999\"} %.9f\n", name(m), s.p999Ns / 1e9);
+        line("hinlibs_op_duration_seconds_sum{op=\"%s\"} %.9f\n", name(m), s.sumNs / 1e9);
+        line("hinlibs_op_duration_seconds_count{op=\"%s\"} %.0f\n", name(m), double(s.count));
+    }
+
+    out += "# HELP hinlibs_lookups_total Catalogue id lookups, and fallback scans.\n"
+           "# TYPE hinlibs_lookups_total counter\n";
+    for (int i = 0; i < MetricCount; ++i) {
+        const Metric m = Metric(i);
+        if (timed(m)) continue;
+        line("hinlibs_lookups_total{op=\"%s\"} %.0f\n", name(m), double(summary(m).count));
+    }
+    return out;
+}
+
+bool Metrics::writeTo(const QString& path, QString* error) {
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+    f.write(path.endsWith(".json") ? toJson() : toPrometheus());
+    if (!f.commit()) {
+        if (error) *error = f.errorString();
+        return false;
+    }
+    return true;
+}
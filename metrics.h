@@ -0,0 +1,79 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+
+// Hot-path instrumentation: per-operation counters and latency histograms.
+//
+// Every thread records into its own buffer (no locks, no shared cache lines);
+// snapshots merge them. Histograms are HDR-style log-linear: 16 sub-buckets
+// per power of two, so any latency from 1 ns to ~18 minutes is kept within
+// about 6% in a fixed 592 buckets.
+//
+// Build with CONFIG += no_metrics (DEFINES += HINLIBS_NO_METRICS) and the
+// HL_TIMED/HL_COUNT probes compile to nothing.
+class Metrics {
+public:
+    enum Metric {
+        // LibraryController queries
+        CanBorrow, CanReturn, CanPlaceHold, CanCancelHold, QueuePosition,
+        // LibraryController commands
+        Borrow, Return, PlaceHold, CancelHold,
+        BorrowBatch, ReturnBatch, PlaceHoldBatch, CancelHoldBatch,
+        RunDueEvents,
+        // Catalogue lookups (counted, not timed: they take nanoseconds)
+        FindItem, FindUser, SlotScan,
+        // Catalogue queries
+        Search, Browse,
+        // MainWindow refresh paths
+        RefreshItems, RefreshDetails, RefreshAccounts, UpdateButtons,
+        MetricCount
+    };
+
+    static const char* name(Metric m);
+    static bool timed(Metric m);
+
+    static void record(Metric m, qint64 ns);
+    static void count(Metric m);
+    static void reset();
+
+    // Merged over all threads. Durations in nanoseconds.
+    struct Summary {
+        quint64 count = 0;
+        quint64 sumNs = 0;
+        quint64 maxNs = 0;
+        quint64 p50Ns = 0, p90Ns = 0, p99Ns = 0, p999Ns = 0;
+    };
+    static Summary summary(Metric m);
+
+    static QByteArray toJson();
+    static QByteArray toPrometheus();
+
+    // Writes toJson() for a path ending in ".json", toPrometheus() otherwise.
+    static bool writeTo(const QString& path, QString* error = nullptr);
+
+    // Times the enclosing scope.
+    class Timer {
+    public:
+        explicit Timer(Metric m) : m_(m) { clock_.start(); }
+        ~Timer() { record(m_, clock_.nsecsElapsed()); }
+    private:
+        Q_DISABLE_COPY(Timer)
+        Metric m_;
+        QElapsedTimer clock_;
+    };
+};
+
+#ifdef HINLIBS_NO_METRICS
+#define HL_TIMED(m) do {} while (0)
+#define HL_COUNT(m) do {} while (0)
+#else
+#define HL_METRICS_CAT2(a, b) a##b
+#define HL_METRICS_CAT(a, b) HL_METRICS_CAT2(a, b)
+#define HL_TIMED(m) Metrics::Timer HL_METRICS_CAT(hlTimer_, __LINE__)(Metrics::m)
+#define HL_COUNT(m) Metrics::count(Metrics::m)
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,291 @@
+#include "nameindex.h"
+#include "user.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Lexicographic on UTF-16 units, like QString's operator<.
+int compareKeys(const ushort* a, int an, const ushort* b, int bn) {
+    const int n = qMin(an, bn);
+    for (int i = 0; i < n; ++i)
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    return an == bn ? 0 : (an < bn ? -1 : 1);
+}
+
+bool startsWith(const ushort* key, int n, const ushort* p, int pn) {
+    return n >= pn && std::memcmp(key, p, size_t(pn) * sizeof(ushort)) == 0;
+}
+
+} // namespace
+
+// Keeps the k closest users, each once; true if the user is new.
+bool NameIndex::offer(QVector<Candidate>& out, int user, int dist, int k) {
+    for (Candidate& c : out) {
+        if (c.user != user) continue;
+        c.dist = qMin(c.dist, dist);
+        return false;
+    }
+    if (out.size() < k) {
+        out.append(Candidate{user, dist});
+        return true;
+    }
+    int worst = 0;
+    for (int i = 1; i < out.size(); ++i)
+        if (out.at(i).dist >= out.at(worst).dist) worst = i;
+    if (dist >= out.at(worst).dist) return false;
+    out[worst] = Candidate{user, dist};
+    return true;
+}
+
+QString NameIndex::normalize(const QString& name) {
+    return name.simplified().toLower();
+}
+
+void NameIndex::keysOf(int userId, const QString& name, KeyList& out) {
+    const QString key = normalize(name);
+    if (key.isEmpty()) return;
+    out.append(qMakePair(key, userId));
+    for (int i = 1; i < key.size(); ++i)
+        if (key.at(i - 1) == QLatin1Char(' ')) out.append(qMakePair(key.mid(i), userId));
+}
+
+void NameIndex::clear() {
+    QMutexLocker locker(&lock_);
+    runs_.clear();
+}
+
+void NameIndex::rebuild(const QList<User>& users) {
+    KeyList keys;
+    keys.reserve(users.size() * 3);
+    for (const User& u : users) keysOf(u.id, u.name, keys);
+    Run run = sorted(keys);
+    QMutexLocker locker(&lock_);
+    runs_.clear();
+    if (run.size()) runs_.append(run);
+}
+
+void NameIndex::add(int userId, const QString& name) {
+    KeyList keys;
+    keysOf(userId, name, keys);
+    if (keys.isEmpty()) return;
+    Run run = sorted(keys);
+    QMutexLocker locker(&lock_);
+    push(run);
+}
+
+// Merging while the last run is no more than twice the new one keeps each
+// run under half the one before it.
+void NameIndex::push(Run run) {
+    while (!runs_.isEmpty() && runs_.last().size() <= 2 * run.size()) {
+        run = merge(runs_.last(), run);
+        runs_.removeLast();
+    }
+    runs_.append(run);
+}
+
+int NameIndex::size() const {
+    QMutexLocker locker(&lock_);
+    int n = 0;
+    for (const Run& r : runs_) n += r.size();
+    return n;
+}
+
+qint64 NameIndex::bytes() const {
+    QMutexLocker locker(&lock_);
+    qint64 n = 0;
+    for (const Run& r : runs_) n += r.bytes();
+    return n;
+}
+
+// ---------------------- Runs ----------------------
+void NameIndex::Run::reserve(int keys, int chars) {
+    text.reserve(chars);
+    start.reserve(keys + 1);
+    user.reserve(keys);
+    shared.reserve(keys);
+}
+
+void NameIndex::Run::append(const ushort* k, int n, int userId) {
+    int s = 0;
+    if (!user.isEmpty()) {
+        const ushort* prev = key(size() - 1);
+        const int limit = qMin(qMin(n, keyLength(size() - 1)), 255);
+        while (s < limit && prev[s] == k[s]) ++s;
+    }
+    if (start.isEmpty()) start.append(0);
+    const int at = text.size();
+    text.resize(at + n);
+    std::memcpy(text.data() + at, k, size_t(n) * sizeof(ushort));
+    start.append(quint32(text.size()));
+    user.append(userId);
+    shared.append(quint8(s));
+    maxLength = qMax(maxLength, n);
+}
+
+qint64 NameIndex::Run::bytes() const {
+    return qint64(text.capacity()) * sizeof(ushort) + qint64(start.capacity()) * sizeof(quint32)
+         + qint64(user.capacity()) * sizeof(int) + qint64(shared.capacity());
+}
+
+NameIndex::Run NameIndex::sorted(KeyList keys) {
+    std::sort(keys.begin(), keys.end());
+    int chars = 0;
+    for (const auto& e : keys) chars += e.first.size();
+    Run run;
+    run.reserve(keys.size(), chars);
+    for (const auto& e : keys) run.append(e.first.utf16(), e.first.size(), e.second);
+    return run;
+}
+
+// Equal keys go in user id order, as sorted() leaves them.
+NameIndex::Run NameIndex::merge(const Run& a, const Run& b) {
+    Run out;
+    out.reserve(a.size() + b.size(), a.text.size() + b.text.size());
+    int i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        bool fromA = j == b.size();
+        if (i < a.size() && j < b.size()) {
+            const int c = compareKeys(a.key(i), a.keyLength(i), b.key(j), b.keyLength(j));
+            fromA = c < 0 || (c == 0 && a.user.at(i) <= b.user.at(j));
+        }
+        if (fromA) { out.append(a.key(i), a.keyLength(i), a.user.at(i)); ++i; }
+        else       { out.append(b.key(j), b.keyLength(j), b.user.at(j)); ++j; }
+    }
+    return out;
+}
+
+int NameIndex::Run::lowerBound(const ushort* p, int n, int from) const {
+    int lo = from, hi = size();
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (compareKeys(key(mid), keyLength(mid), p, n) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Keys starting with p are contiguous; `from` is one of them.
+int NameIndex::Run::endOfPrefix(const ushort* p, int n, int from) const {
+    int lo = from, hi = size();
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (startsWith(key(mid), keyLength(mid), p, n)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// ---------------------- Queries ----------------------
+// Each run's first k users in key order, then the first k of those overall:
+// a user among the first k overall is among the first k of its own run.
+QVector<int> NameIndex::complete(const QString& prefix, int k) const {
+    QVector<int> out;
+    const QString p = normalize(prefix);
+    if (p.isEmpty() || k <= 0) return out;
+    const ushort* pk = p.utf16();
+
+    struct Hit { const ushort* key; int length; int user; };
+    QVector<Hit> hits;
+    QMutexLocker locker(&lock_);
+    hits.reserve(k * runs_.size());
+    for (const Run& run : runs_) {
+        const int from = hits.size();
+        for (int i = run.lowerBound(pk, p.size(), 0); i < run.size() && hits.size() - from < k; ++i) {
+            if (!startsWith(run.key(i), run.keyLength(i), pk, p.size())) break;
+            const int u = run.user.at(i);
+            if (std::any_of(hits.constBegin() + from, hits.constEnd(), [u](const Hit& h){ return h.user == u; })) continue;
+            hits.append(Hit{run.key(i), run.keyLength(i), u});
+        }
+    }
+    if (runs_.size() > 1) {
+        std::stable_sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+            const int c = compareKeys(a.key, a.length, b.key, b.length);
+            return c < 0 || (c == 0 && a.user < b.user);
+        });
+    }
+    for (const Hit& h : hits) {
+        if (out.size() == k) break;
+        if (!out.contains(h.user)) out.append(h.user);
+    }
+    return out;
+}
+
+QVector<int> NameIndex::closest(const QString& name, int maxEdits, int k) const {
+    QVector<int> ids;
+    const QString q = normalize(name);
+    if (q.isEmpty() || k <= 0 || maxEdits < 0) return ids;
+
+    QVector<Candidate> out;
+    QVector<int> rows, best;
+    QMutexLocker locker(&lock_);
+    for (const Run& run : runs_) run.closest(q.utf16(), q.size(), maxEdits, k, rows, best, out);
+    locker.unlock();
+
+    std::stable_sort(out.begin(), out.end(), [](const Candidate& a, const Candidate& b){ return a.dist < b.dist; });
+    ids.reserve(out.size());
+    for (const Candidate& c : out) ids.append(c.user);
+    return ids;
+}
+
+// Optimal string alignment distance (Levenshtein plus adjacent swaps),
+// row d for the key's first d characters. A key matches at the end of any
+// of its words: best[d] is the closest such word end within its first d
+// characters. Cells further than maxEdits from the diagonal are never under
+// the limit, so only the band is computed; the rest stay at `far`.
+void NameIndex::Run::closest(const ushort* qs, int m, int maxEdits, int k,
+                             QVector<int>& rows, QVector<int>& best, QVector<Candidate>& out) const {
+    const int width = m + 1;
+    const int far = maxEdits + 1;
+    rows.fill(far, (maxLength + 1) * width);
+    best.resize(maxLength + 1);
+    for (int j = 0; j <= qMin(m, maxEdits); ++j) rows[j] = j;
+    best[0] = far;
+
+    const int n = size();
+    int valid = 0;     // rows[0..valid] follow the previous key
+    int i = 0;
+    while (i < n) {
+        const ushort* kk = key(i);
+        const int length = keyLength(i);
+        int d = qMin(valid, i > 0 ? int(shared.at(i)) : 0);
+        bool skipped = false;
+        for (; d < length; ++d) {
+            const int* above = rows.constData() + d * width;
+            int* row = rows.data() + (d + 1) * width;
+            const ushort c = kk[d];
+            int low = far;
+            if (d + 1 <= maxEdits) low = row[0] = d + 1;
+            const int hi = qMin(m, d + 1 + maxEdits);
+            for (int j = qMax(1, d + 1 - maxEdits); j <= hi; ++j) {
+                int v = qMin(qMin(above[j], row[j - 1]) + 1, above[j - 1] + (c != qs[j - 1] ? 1 : 0));
+                if (d > 0 && j > 1 && c == qs[j - 2] && kk[d - 1] == qs[j - 1])
+                    v = qMin(v, rows.at((d - 1) * width + j - 2) + 1);
+                row[j] = qMin(v, far);
+                low = qMin(low, v);
+            }
+            best[d + 1] = qMin(best[d], c == ' ' ? above[m] : far);
+
+            if (low > maxEdits) {
+                // Nothing under this prefix gets any closer: every key in the
+                // block ends up at best[d + 1].
+                const int end = endOfPrefix(kk, d + 1, i);
+                if (best[d + 1] <= maxEdits) {
+                    int added = 0;
+                    for (int b = i; b < end && added < k; ++b) added += offer(out, user.at(b), best[d + 1], k);
+                }
+                valid = d + 1;
+                i = end;
+                skipped = true;
+                break;
+            }
+        }
+        if (skipped) continue;
+
+        valid = length;
+        const int dist = qMin(best[length], rows.at(length * width + m));
+        if (dist <= maxEdits) offer(out, user.at(i), dist, k);
+        ++i;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+class User;
+
+// User names for the login field: prefix completion and typo-tolerant
+// lookup. Each name is indexed normalized (lower case, single spaces) and
+// again from each later word on, so "smi" finds "Bob Smith".
+//
+// The keys sit sorted in one UTF-16 buffer with, per key, the length it
+// shares with the one before: an implicit trie. A prefix is a binary search.
+// A fuzzy lookup walks the keys in order and keeps one edit-distance row per
+// character, reusing the rows of the shared prefix and filling only the
+// cells within maxEdits of the diagonal; once every entry of a row is over
+// the limit, the whole block of keys under that prefix is skipped with
+// another binary search. Neither allocates in proportion to the number of
+// users.
+//
+// add() sorts the new keys into a run of their own and merges runs of
+// similar size, like a binary counter: there are O(log n) runs, a key is
+// copied O(log n) times over all adds, and queries only search the runs.
+class NameIndex {
+public:
+    void clear();
+    void rebuild(const QList<User>& users);
+    void add(int userId, const QString& name);
+    int  size() const;         // indexed keys, about words-per-name per user
+    qint64 bytes() const;
+
+    // Up to k user ids, in key order, each once.
+    QVector<int> complete(const QString& prefix, int k) const;
+
+    // Up to k user ids whose name, or its tail from some word on, matches
+    // `name` for whole words within maxEdits insertions, deletions,
+    // substitutions or swaps of neighbours; closest first.
+    QVector<int> closest(const QString& name, int maxEdits, int k) const;
+
+    static QString normalize(const QString& name);
+
+private:
+    struct Candidate {
+        int user;
+        int dist;
+    };
+    static bool offer(QVector<Candidate>& out, int user, int dist, int k);
+
+    // One sorted run of keys, as described above.
+    struct Run {
+        QVector<ushort>  text;     // keys back to back
+        QVector<quint32> start;    // key i is text[start[i], start[i + 1])
+        QVector<int>     user;
+        QVector<quint8>  shared;   // prefix shared with key i - 1, capped at 255
+        int maxLength = 0;
+
+        int size() const { return user.size(); }
+        int keyLength(int i) const { return int(start.at(i + 1) - start.at(i)); }
+        const ushort* key(int i) const { return text.constData() + start.at(i); }
+        int lowerBound(const ushort* p, int n, int from) const;   // first key >= p
+        int endOfPrefix(const ushort* p, int n, int from) const;  // first key past the p block
+        void append(const ushort* k, int n, int userId);          // k sorts last
+        void reserve(int keys, int chars);
+        qint64 bytes() const;
+
+        // rows and best are scratch space, shared between runs.
+        void closest(const ushort* q, int m, int maxEdits, int k,
+                     QVector<int>& rows, QVector<int>& best, QVector<Candidate>& out) const;
+    };
+    typedef QVector<QPair<QString, int>> KeyList;   // (key, user id)
+    static void keysOf(int userId, const QString& name, KeyList& out);
+    static Run sorted(KeyList keys);
+    static Run merge(const Run& a, const Run& b);
+    void push(Run run);        // caller holds lock_
+
+    mutable QMutex lock_;
+    QVector<Run> runs_;        // each under half the size of the one before
+};
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,70 @@
+#include "circulationclient.h"
+#include <QElapsedTimer>
+
+CirculationClient::CirculationClient(QObject* parent) : QObject(parent) {
+    connect(&socket_, &QLocalSocket::readyRead, this, &CirculationClient::onReadyRead);
+    connect(&socket_, &QLocalSocket::disconnected, this, &CirculationClient::disconnected);
+}
+
+bool CirculationClient::connectToServer(const QString& name, int timeoutMs) {
+    socket_.connectToServer(name);
+    return socket_.waitForConnected(timeoutMs);
+}
+
+void CirculationClient::disconnectFromServer() {
+    socket_.disconnectFromServer();
+}
+
+quint32 CirculationClient::submit(Protocol::Op op, int userId, int itemId) {
+    Protocol::Request r;
+    r.requestId = nextId_++;
+    r.op = op;
+    r.userId = userId;
+    r.itemId = itemId;
+    Protocol::encode(outbox_, r);
+    ++outstanding_;
+    return r.requestId;
+}
+
+void CirculationClient::flush() {
+    if (outbox_.isEmpty()) return;
+    socket_.write(outbox_);
+    outbox_.clear();
+}
+
+void CirculationClient::onReadyRead() {
+    inbox_ += socket_.readAll();
+    int offset = 0;
+    Protocol::Reply r;
+    Protocol::Decode d;
+    while ((d = Protocol::decode(inbox_, &offset, &r)) == Protocol::Decoded) {
+        --outstanding_;
+        if (r.requestId == awaiting_) { awaited_ = r; haveAwaited_ = true; }
+        emit replied(r);
+    }
+    if (d == Protocol::Malformed) {
+        socket_.abort();
+        inbox_.clear();
+        return;
+    }
+    inbox_.remove(0, offset);
+}
+
+Protocol::Reply CirculationClient::call(Protocol::Op op, int userId, int itemId, int timeoutMs) {
+    awaiting_ = submit(op, userId, itemId);
+    haveAwaited_ = false;
+    flush();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!haveAwaited_ && isConnected()) {
+        const int left = timeoutMs - int(timer.elapsed());
+        if (left <= 0 || !socket_.waitForReadyRead(left)) break;
+    }
+    awaiting_ = 0;
+    if (haveAwaited_) return awaited_;
+
+    Protocol::Reply fail;
+    fail.message = "No reply from server.";
+    return fail;
+}
@@ -0,0 +1,45 @@
+#ifndef CIRCULATIONCLIENT_H
+#define CIRCULATIONCLIENT_H
+
+#include <QObject>
+#include <QLocalSocket>
+#include "protocol.h"
+
+// Connection to a hinlibsd instance. submit() queues requests without
+// waiting (pipelining) and replied() reports them in order; call() is a
+// blocking round trip for scripts and kiosks.
+class CirculationClient : public QObject {
+    Q_OBJECT
+public:
+    explicit CirculationClient(QObject* parent=nullptr);
+
+    bool connectToServer(const QString& name, int timeoutMs = 3000);
+    void disconnectFromServer();
+    bool isConnected() const { return socket_.state() == QLocalSocket::ConnectedState; }
+
+    quint32 submit(Protocol::Op op, int userId, int itemId = -1);   // returns the request id
+    void    flush();                                                 // push queued requests out
+    int     outstanding() const { return outstanding_; }
+
+    Protocol::Reply call(Protocol::Op op, int userId, int itemId = -1, int timeoutMs = 3000);
+
+signals:
+    void replied(const Protocol::Reply& reply);
+    void disconnected();
+
+private slots:
+    void onReadyRead();
+
+private:
+    QLocalSocket socket_;
+    QByteArray inbox_;
+    QByteArray outbox_;
+    quint32 nextId_ = 1;
+    int outstanding_ = 0;
+
+    quint32 awaiting_ = 0;         // request id call() is blocked on
+    bool haveAwaited_ = false;
+    Protocol::Reply awaited_;
+};
+
+#endif // CIRCULATIONCLIENT_H
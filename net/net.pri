@@ -0,0 +1,13 @@
+# Client side of the hinlibsd socket protocol (no dependency on core.pri).
+
+QT += network
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+SOURCES += \
+    $$PWD/circulationclient.cpp
+
+HEADERS += \
+    $$PWD/circulationclient.h \
+    $$PWD/protocol.h
@@ -0,0 +1,112 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtEndian>
+#include <cstring>
+
+// Wire format between hinlibsd and its clients. Every frame is a u32
+// little-endian length (of what follows) and a fixed body; clients may
+// pipeline any number of requests and replies come back in order.
+//
+//   request : u32 len | u32 requestId | u8 op | i32 userId | i32 itemId
+//   reply   : u32 len | u32 requestId | u8 ok | i32 aux | u16 n | n bytes UTF-8 message
+namespace Protocol {
+
+enum Op : quint8 {
+    Borrow = 1, Return = 2, PlaceHold = 3, CancelHold = 4,
+    CanBorrow = 5, CanReturn = 6, CanPlaceHold = 7, CanCancelHold = 8,
+    QueuePosition = 9,   // aux = 1-based position or -1
+    ItemStatus = 10      // aux = borrower id or -1; message = due date (yyyy-MM-dd)
+};
+
+struct Request {
+    quint32 requestId = 0;
+    Op op = Borrow;
+    int userId = -1;
+    int itemId = -1;
+};
+
+struct Reply {
+    quint32 requestId = 0;
+    bool ok = false;
+    int aux = 0;
+    QString message;
+};
+
+enum Decode { NeedMore, Decoded, Malformed };
+
+const int kRequestBody = 13;
+const int kReplyHeader = 11;          // requestId, ok, aux, message length
+const int kMaxFrame    = 64 * 1024;
+
+// UTF-8 of s, cut to at most max bytes without splitting a sequence.
+inline QByteArray utf8Prefix(const QString& s, int max) {
+    QByteArray b = s.toUtf8();
+    if (b.size() <= max) return b;
+    int n = max;
+    while (n > 0 && (uchar(b.at(n)) & 0xC0) == 0x80) --n;
+    b.truncate(n);
+    return b;
+}
+
+inline void encode(QByteArray& out, const Request& r) {
+    const int at = out.size();
+    out.resize(at + 4 + kRequestBody);
+    uchar* p = reinterpret_cast<uchar*>(out.data()) + at;
+    qToLittleEndian<quint32>(kRequestBody, p);
+    qToLittleEndian<quint32>(r.requestId, p + 4);
+    p[8] = r.op;
+    qToLittleEndian<qint32>(r.userId, p + 9);
+    qToLittleEndian<qint32>(r.itemId, p + 13);
+}
+
+inline void encode(QByteArray& out, const Reply& r) {
+    const QByteArray msg = utf8Prefix(r.message, kMaxFrame - kReplyHeader);
+    const int body = kReplyHeader + msg.size();
+    const int at = out.size();
+    out.resize(at + 4 + body);
+    uchar* p = reinterpret_cast<uchar*>(out.data()) + at;
+    qToLittleEndian<quint32>(quint32(body), p);
+    qToLittleEndian<quint32>(r.requestId, p + 4);
+    p[8] = r.ok ? 1 : 0;
+    qToLittleEndian<qint32>(r.aux, p + 9);
+    qToLittleEndian<quint16>(quint16(msg.size()), p + 13);
+    memcpy(p + 15, msg.constData(), size_t(msg.size()));
+}
+
+// Decode the frame at *offset; on success *offset moves past it.
+inline Decode decode(const QByteArray& in, int* offset, Request* r) {
+    if (in.size() - *offset < 4) return NeedMore;
+    const uchar* p = reinterpret_cast<const uchar*>(in.constData()) + *offset;
+    const quint32 len = qFromLittleEndian<quint32>(p);
+    if (len != quint32(kRequestBody)) return Malformed;
+    if (in.size() - *offset < 4 + kRequestBody) return NeedMore;
+    r->requestId = qFromLittleEndian<quint32>(p + 4);
+    r->op        = Op(p[8]);
+    r->userId    = qFromLittleEndian<qint32>(p + 9);
+    r->itemId    = qFromLittleEndian<qint32>(p + 13);
+    *offset += 4 + kRequestBody;
+    return Decoded;
+}
+
+inline Decode decode(const QByteArray& in, int* offset, Reply* r) {
+    if (in.size() - *offset < 4) return NeedMore;
+    const uchar* p = reinterpret_cast<const uchar*>(in.constData()) + *offset;
+    const quint32 len = qFromLittleEndian<quint32>(p);
+    if (len < quint32(kReplyHeader) || len > quint32(kMaxFrame)) return Malformed;
+    if (quint32(in.size() - *offset - 4) < len) return NeedMore;
+    const quint16 n = qFromLittleEndian<quint16>(p + 13);
+    if (quint32(kReplyHeader) + n != len) return Malformed;
+    r->requestId = qFromLittleEndian<quint32>(p + 4);
+    r->ok        = p[8] != 0;
+    r->aux       = qFromLittleEndian<qint32>(p + 9);
+    r->message   = QString::fromUtf8(reinterpret_cast<const char*>(p + 15), n);
+    *offset += 4 + int(len);
+    return Decoded;
+}
+
+} // namespace Protocol
+
+#endif // PROTOCOL_H
@@ -0,0 +1,78 @@
+#ifndef PERSISTENTVECTOR_H
+#define PERSISTENTVECTOR_H
+
+#include <QtGlobal>
+#include <memory>
+
+// Indexed sequence with cheap immutable copies: a 32-way trie whose nodes are
+// shared between copies and reference counted. Copying is O(1); a write
+// copies only the nodes on its path that it doesn't own.
+//
+// Ownership is by edit tag: a node created or copied under edit E may be
+// changed in place by later writes under E. Writes under a new tag treat
+// every older node as frozen. So a writer keeps one tag while no copy of
+// the vector has escaped, and moves to a fresh tag once one has; the copy
+// then never sees another write, and can be read from any thread.
+template <typename T>
+class PersistentVector {
+public:
+    int size() const { return size_; }
+    bool isEmpty() const { return size_ == 0; }
+
+    const T& at(int i) const {
+        const Node* n = root_.get();
+        for (int shift = shift_; shift > 0; shift -= kBits)
+            n = static_cast<const Inner*>(n)->kids[(i >> shift) & kMask].get();
+        return static_cast<const Leaf*>(n)->vals[i & kMask];
+    }
+
+    void set(int i, const T& value, quint64 edit) { edited(i, edit) = value; }
+
+    // Element i, to change in place: its path is copied as set() would.
+    T& edited(int i, quint64 edit) {
+        std::shared_ptr<Node>* ref = &root_;
+        for (int shift = shift_; ; shift -= kBits) {
+            *ref = editable(*ref, shift, edit);
+            if (shift == 0) return static_cast<Leaf*>(ref->get())->vals[i & kMask];
+            ref = &static_cast<Inner*>(ref->get())->kids[(i >> shift) & kMask];
+        }
+    }
+
+    void append(const T& value, quint64 edit) {
+        if (root_ && size_ == (1 << (shift_ + kBits))) {
+            std::shared_ptr<Inner> grown = std::make_shared<Inner>();
+            grown->edit = edit;
+            grown->kids[0] = root_;
+            root_ = grown;
+            shift_ += kBits;
+        }
+        set(size_++, value, edit);
+    }
+
+    void clear() { root_.reset(); size_ = 0; shift_ = 0; }
+
+private:
+    static const int kBits = 5;
+    static const int kWidth = 1 << kBits;
+    static const int kMask = kWidth - 1;
+
+    struct Node  { quint64 edit = 0; };
+    struct Inner : Node { std::shared_ptr<Node> kids[kWidth]; };
+    struct Leaf  : Node { T vals[kWidth]; };
+
+    // n itself if this edit owns it, else a copy that it does.
+    static std::shared_ptr<Node> editable(const std::shared_ptr<Node>& n, int shift, quint64 edit) {
+        if (n && n->edit == edit) return n;
+        std::shared_ptr<Node> out;
+        if (shift == 0) out = n ? std::make_shared<Leaf>(*static_cast<const Leaf*>(n.get())) : std::make_shared<Leaf>();
+        else            out = n ? std::make_shared<Inner>(*static_cast<const Inner*>(n.get())) : std::make_shared<Inner>();
+        out->edit = edit;
+        return out;
+    }
+
+    std::shared_ptr<Node> root_;
+    int size_ = 0;
+    int shift_ = 0;    // kBits * (levels above the leaves)
+};
+
+#endif // PERSISTENTVECTOR_H
@@ -0,0 +1,243 @@
+#include "relationstore.h"
+#include <algorithm>
+#include <cstring>
+
+const quint64 RelationStore::EdgeSet::kEmpty;
+const quint64 RelationStore::EdgeSet::kGone;
+
+// ---------------------- Adjacency ----------------------
+quint32 RelationStore::Adjacency::room(quint32 n) {
+    if (n == 0) return 0;
+    quint32 r = 1;
+    while (r < n) r <<= 1;
+    return r;
+}
+
+void RelationStore::Adjacency::clear() {
+    offset_.clear();
+    size_.clear();
+    pool_.clear();
+    dead_ = 0;
+}
+
+void RelationStore::Adjacency::resize(int vertices) {
+    if (vertices <= size()) return;
+    offset_.resize(vertices);   // new entries are zero: empty runs
+    size_.resize(vertices);
+}
+
+void RelationStore::Adjacency::rebuild(int vertices, const QVector<Edge>& edges, bool byUser) {
+    clear();
+    offset_.resize(vertices);
+    size_.resize(vertices);
+    for (const Edge& e : edges) ++size_[byUser ? e.user : e.item];
+
+    quint32 at = 0;
+    for (int v = 0; v < vertices; ++v) {
+        offset_[v] = at;
+        at += room(size_.at(v));
+    }
+    pool_.resize(int(at));
+
+    // Fill in edge order, so each run keeps the order edges were given in.
+    QVector<quint32> filled(vertices, 0);
+    for (const Edge& e : edges) {
+        const int v = byUser ? e.user : e.item;
+        pool_[int(offset_.at(v) + filled[v]++)] = byUser ? e.item : e.user;
+    }
+}
+
+const int* RelationStore::Adjacency::run(int v, int* n) const {
+    *n = degree(v);
+    return *n ? pool_.constData() + offset_.at(v) : nullptr;
+}
+
+void RelationStore::Adjacency::add(int v, int to) {
+    const quint32 n = size_.at(v);
+    if (n == room(n)) {   // full (or empty): needs a bigger run
+        const quint32 grown = room(n + 1);
+        const quint32 off = offset_.at(v);
+        if (n > 0 && off + n == quint32(pool_.size())) {
+            pool_.resize(int(off + grown));   // last run: grow in place
+        } else {
+            const quint32 at = quint32(pool_.size());
+            pool_.resize(int(at + grown));
+            if (n) std::memcpy(pool_.data() + at, pool_.constData() + off, n * sizeof(int));
+            offset_[v] = at;
+            dead_ += n;
+        }
+    }
+    pool_[int(offset_.at(v) + n)] = to;
+    size_[v] = n + 1;
+    if (pool_.size() > 1024 && dead_ > pool_.size() / 2) compact();
+}
+
+// Keeps the run's order; room the smaller run doesn't claim is dead.
+bool RelationStore::Adjacency::remove(int v, int to) {
+    const quint32 n = size_.at(v);
+    int* first = pool_.data() + offset_.at(v);
+    int* last = first + n;
+    int* hit = std::find(first, last, to);
+    if (hit == last) return false;
+    std::memmove(hit, hit + 1, (last - hit - 1) * sizeof(int));
+    size_[v] = n - 1;
+    dead_ += room(n) - room(n - 1);
+
+    if (pool_.size() > 1024 && dead_ > pool_.size() / 2) compact();
+    return true;
+}
+
+void RelationStore::Adjacency::compact() {
+    QVector<int> pool;
+    qint64 live = 0;
+    for (int v = 0; v < size(); ++v) live += room(size_.at(v));
+    pool.resize(int(live));
+    quint32 at = 0;
+    for (int v = 0; v < size(); ++v) {
+        const quint32 n = size_.at(v);
+        if (n) std::memcpy(pool.data() + at, pool_.constData() + offset_.at(v), n * sizeof(int));
+        offset_[v] = at;
+        at += room(n);
+    }
+    pool_.swap(pool);
+    dead_ = 0;
+}
+
+qint64 RelationStore::Adjacency::bytes() const {
+    return qint64(offset_.capacity() + size_.capacity()) * sizeof(quint32)
+         + qint64(pool_.capacity()) * sizeof(int);
+}
+
+// ---------------------- EdgeSet ----------------------
+static inline quint64 mix(quint64 k) {
+    k ^= k >> 33; k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33; k *= 0xc4ceb9fe1a85ec53ULL;
+    return k ^ (k >> 33);
+}
+
+void RelationStore::EdgeSet::clear() {
+    slots_.clear();
+    used_ = gone_ = 0;
+}
+
+void RelationStore::EdgeSet::reserve(int n) {
+    int cap = 16;
+    while (cap < n * 2) cap <<= 1;
+    if (cap > slots_.size()) rehash(cap);
+}
+
+int RelationStore::EdgeSet::find(quint64 key) const {
+    if (slots_.isEmpty()) return -1;
+    const int mask = slots_.size() - 1;
+    for (int i = int(mix(key)) & mask;; i = (i + 1) & mask) {
+        const quint64 s = slots_.at(i);
+        if (s == key) return i;
+        if (s == kEmpty) return -1;
+    }
+}
+
+bool RelationStore::EdgeSet::insert(quint64 key) {
+    // At most 3/4 full counting tombstones; a rehash drops those.
+    if ((used_ + gone_ + 1) * 4 > slots_.size() * 3) {
+        int cap = 16;
+        while (cap < (used_ + 1) * 2) cap <<= 1;
+        rehash(cap);
+    }
+    const int mask = slots_.size() - 1;
+    int tomb = -1;
+    for (int i = int(mix(key)) & mask;; i = (i + 1) & mask) {
+        const quint64 s = slots_.at(i);
+        if (s == key) return false;
+        if (s == kGone) {
+            if (tomb < 0) tomb = i;
+        } else if (s == kEmpty) {
+            if (tomb >= 0) { i = tomb; --gone_; }
+            slots_[i] = key;
+            ++used_;
+            return true;
+        }
+    }
+}
+
+bool RelationStore::EdgeSet::erase(quint64 key) {
+    const int i = find(key);
+    if (i < 0) return false;
+    slots_[i] = kGone;
+    --used_;
+    ++gone_;
+    return true;
+}
+
+bool RelationStore::EdgeSet::contains(quint64 key) const {
+    return find(key) >= 0;
+}
+
+void RelationStore::EdgeSet::rehash(int capacity) {
+    QVector<quint64> old;
+    old.swap(slots_);
+    slots_.fill(kEmpty, capacity);
+    used_ = gone_ = 0;
+    const int mask = capacity - 1;
+    for (quint64 key : old) {
+        if (key == kEmpty || key == kGone) continue;
+        int i = int(mix(key)) & mask;
+        while (slots_.at(i) != kEmpty) i = (i + 1) & mask;
+        slots_[i] = key;
+        ++used_;
+    }
+}
+
+// ---------------------- RelationStore ----------------------
+void RelationStore::clear() {
+    for (int r = 0; r < 2; ++r) {
+        byUser_[r].clear();
+        byItem_[r].clear();
+        members_[r].clear();
+    }
+}
+
+void RelationStore::resize(int users, int items) {
+    for (int r = 0; r < 2; ++r) {
+        byUser_[r].resize(users);
+        byItem_[r].resize(items);
+    }
+}
+
+void RelationStore::rebuild(Relation r, const QVector<Edge>& edges) {
+    EdgeSet& members = members_[int(r)];
+    members.clear();
+    members.reserve(edges.size());
+    QVector<Edge> kept;
+    kept.reserve(edges.size());
+    for (const Edge& e : edges) {
+        if (e.user < 0 || e.user >= users() || e.item < 0 || e.item >= items()) continue;
+        if (members.insert(key(e.user, e.item))) kept.append(e);
+    }
+    byUser_[int(r)].rebuild(users(), kept, true);
+    byItem_[int(r)].rebuild(items(), kept, false);
+}
+
+bool RelationStore::add(Relation r, int user, int item) {
+    if (user < 0 || user >= users() || item < 0 || item >= items()) return false;
+    if (!members_[int(r)].insert(key(user, item))) return false;
+    byUser_[int(r)].add(user, item);
+    byItem_[int(r)].add(item, user);
+    return true;
+}
+
+bool RelationStore::remove(Relation r, int user, int item) {
+    if (!members_[int(r)].erase(key(user, item))) return false;
+    byUser_[int(r)].remove(user, item);
+    byItem_[int(r)].remove(item, user);
+    return true;
+}
+
+bool RelationStore::has(Relation r, int user, int item) const {
+    return members_[int(r)].contains(key(user, item));
+}
+
+qint64 RelationStore::bytes() const {
+    qint64 n = 0;
+    for (int r = 0; r < 2; ++r) n += byUser_[r].bytes() + byItem_[r].bytes() + members_[r].bytes();
+    return n;
+}
@@ -0,0 +1,98 @@
+#ifndef RELATIONSTORE_H
+#define RELATIONSTORE_H
+
+#include <QVector>
+
+enum class Relation { Loan, Hold };
+
+// Loan and hold edges between users and items, kept in both directions so
+// "what does this patron hold" and "who holds this item" are both O(degree).
+// Vertices are dense rows (Catalogue slots); edges store the other end's row.
+//
+// Each direction is CSR-style: one pool of rows, each vertex owning a run
+// [offset, offset + size) with room for the next power of two. A run that
+// outgrows its room moves to the end of the pool; the pool is compacted once
+// most of it is dead. A vertex costs 8 bytes per direction and relation plus
+// its entries, so a million patrons with their loans and holds fit in tens
+// of megabytes. Membership is an open-addressing set of packed (user, item)
+// pairs, which makes has() and the duplicate check in add() O(1).
+class RelationStore {
+public:
+    void clear();
+    void resize(int users, int items);   // added vertices start with no edges
+    int  users() const { return byUser_[0].size(); }
+    int  items() const { return byItem_[0].size(); }
+
+    // Edges are (user row, item row). Replaces every edge of r.
+    struct Edge { int user; int item; };
+    void rebuild(Relation r, const QVector<Edge>& edges);
+
+    bool add(Relation r, int user, int item);      // false if already there
+    bool remove(Relation r, int user, int item);   // false if absent
+    bool has(Relation r, int user, int item) const;
+
+    int  edges(Relation r) const { return members_[int(r)].size(); }
+    int  itemDegree(Relation r, int user) const { return byUser_[int(r)].degree(user); }
+    int  userDegree(Relation r, int item) const { return byItem_[int(r)].degree(item); }
+
+    // Neighbours in the order they were added; the pointer is valid until
+    // the next edit.
+    const int* itemsOf(Relation r, int user, int* n) const { return byUser_[int(r)].run(user, n); }
+    const int* usersOf(Relation r, int item, int* n) const { return byItem_[int(r)].run(item, n); }
+
+    qint64 bytes() const;   // heap footprint, for benches
+
+private:
+    // One direction of one relation.
+    class Adjacency {
+    public:
+        int  size() const { return offset_.size(); }
+        void clear();
+        void resize(int vertices);
+        void rebuild(int vertices, const QVector<Edge>& edges, bool byUser);
+        int  degree(int v) const { return v >= 0 && v < size() ? int(size_.at(v)) : 0; }
+        const int* run(int v, int* n) const;
+        void add(int v, int to);
+        bool remove(int v, int to);
+        qint64 bytes() const;
+
+    private:
+        static quint32 room(quint32 n);   // run capacity for n entries
+        void compact();
+
+        QVector<quint32> offset_;   // per vertex
+        QVector<quint32> size_;     // per vertex
+        QVector<int> pool_;
+        qint64 dead_ = 0;           // pool entries outside every run's room
+    };
+
+    // Open addressing, linear probing, tombstones.
+    class EdgeSet {
+    public:
+        int  size() const { return used_; }
+        void clear();
+        void reserve(int n);
+        bool insert(quint64 key);
+        bool erase(quint64 key);
+        bool contains(quint64 key) const;
+        qint64 bytes() const { return qint64(slots_.capacity()) * sizeof(quint64); }
+
+    private:
+        static const quint64 kEmpty = ~quint64(0);
+        static const quint64 kGone = ~quint64(0) - 1;
+        int  find(quint64 key) const;     // slot holding key, or -1
+        void rehash(int capacity);
+
+        QVector<quint64> slots_;
+        int used_ = 0;
+        int gone_ = 0;
+    };
+
+    static quint64 key(int user, int item) { return (quint64(quint32(user)) << 32) | quint32(item); }
+
+    Adjacency byUser_[2];
+    Adjacency byItem_[2];
+    EdgeSet members_[2];
+};
+
+#endif // RELATIONSTORE_H
@@ -0,0 +1,276 @@
+#include "reportengine.h"
+#include "cataloguesnapshot.h"
+#include "itempolicy.h"
+#include <QHash>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
+
+const qint64 ReportTable::kNoDay = std::numeric_limits<qint64>::min();
+
+void ReportTable::reserve(int n) {
+    id.reserve(n); type.reserve(n); status.reserve(n);
+    borrowerId.reserve(n); due.reserve(n); holds.reserve(n);
+}
+
+void ReportTable::append(const Item& it) {
+    id.append(it.id);
+    type.append(quint8(it.type));
+    status.append(quint8(it.status));
+    borrowerId.append(it.borrowerId);
+    due.append(it.due.isValid() ? it.due.toJulianDay() : kNoDay);
+    holds.append(it.holdQueue.size());
+}
+
+ReportTable ReportTable::from(const CatalogueSnapshot& snap) {
+    ReportTable t;
+    t.reserve(snap.itemCount());
+    for (int i = 0; i < snap.itemCount(); ++i) t.append(snap.itemAt(i));
+    return t;
+}
+
+ReportQuery ReportQuery::loansPerType() {
+    ReportQuery q;
+    q.status = int(Availability::CheckedOut);
+    q.groupBy = ByType;
+    return q;
+}
+
+ReportQuery ReportQuery::longestHoldQueues(int k) {
+    ReportQuery q;
+    q.groupBy = ByItem;
+    q.measure = HoldQueueLength;
+    q.topK = k;
+    return q;
+}
+
+ReportQuery ReportQuery::overdueByPatron(const QDate& today, int k) {
+    ReportQuery q;
+    q.overdueOnly = true;
+    q.today = today;
+    q.groupBy = ByBorrower;
+    q.topK = k;
+    return q;
+}
+
+namespace {
+
+const int kChunk = 16384;   // rows per unit of work
+
+// What one thread has aggregated so far.
+struct Partial {
+    qint64 small[8] = {};              // ByType / ByStatus totals
+    QHash<qint64, qint64> groups;      // ByBorrower
+    QVector<ReportRow> rows;           // ByItem (a min-heap when top-k)
+};
+
+bool byValueDesc(const ReportRow& a, const ReportRow& b) {
+    return a.value != b.value ? a.value > b.value : a.key < b.key;
+}
+
+// Keeps the k largest rows; heap front is the smallest kept.
+void offer(QVector<ReportRow>& heap, const ReportRow& row, int k) {
+    if (heap.size() < k) {
+        heap.append(row);
+        std::push_heap(heap.begin(), heap.end(), byValueDesc);
+    } else if (byValueDesc(row, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), byValueDesc);
+        heap.last() = row;
+        std::push_heap(heap.begin(), heap.end(), byValueDesc);
+    }
+}
+
+class Scan {
+public:
+    Scan(const ReportTable& t, const ReportQuery& q) : t_(t), q_(q) {
+        for (int v = 0; v < 256; ++v) {
+            acceptType_[v] = v < 32 && ((q.typeMask >> v) & 1u) ? 1 : 0;
+            acceptStatus_[v] = q.status < 0 || q.status == v ? 1 : 0;
+        }
+        todayJd_ = q.today.isValid() ? q.today.toJulianDay() : std::numeric_limits<qint64>::max();
+    }
+
+    void chunk(int c, Partial& out) const {
+        const int begin = c * kChunk;
+        const int n = qMin(kChunk, t_.size() - begin);
+        const quint8* type = t_.type.constData() + begin;
+        const quint8* status = t_.status.constData() + begin;
+        const qint64* due = t_.due.constData() + begin;
+        const int* holds = t_.holds.constData() + begin;
+        const quint8 anyDue = q_.overdueOnly ? 0 : 1;
+        const quint8 checkedOut = quint8(Availability::CheckedOut);
+
+        // Filter without branches: one pass byte per row.
+        quint8 pass[kChunk];
+        for (int i = 0; i < n; ++i) {
+            const quint8 overdue = quint8(status[i] == checkedOut) & quint8(due[i] < todayJd_);
+            pass[i] = acceptType_[type[i]] & acceptStatus_[status[i]] & (overdue | anyDue);
+        }
+
+        const bool count = q_.measure == ReportQuery::Count;
+        switch (q_.groupBy) {
+            case ReportQuery::ByType:
+            case ReportQuery::ByStatus: {
+                const quint8* key = q_.groupBy == ReportQuery::ByType ? type : status;
+                const int groups = q_.groupBy == ReportQuery::ByType ? kItemTypeCount : 2;
+                for (int g = 0; g < groups; ++g) {
+                    qint64 sum = 0;
+                    if (count) for (int i = 0; i < n; ++i) sum += pass[i] & quint8(key[i] == g);
+                    else       for (int i = 0; i < n; ++i) sum += -int(pass[i] & quint8(key[i] == g)) & holds[i];
+                    out.small[g] += sum;
+                }
+                break;
+            }
+            case ReportQuery::ByBorrower: {
+                const int* borrower = t_.borrowerId.constData() + begin;
+                for (int i = 0; i < n; ++i)
+                    if (pass[i]) out.groups[borrower[i]] += count ? 1 : holds[i];
+                break;
+            }
+            case ReportQuery::ByItem: {
+                const int* id = t_.id.constData() + begin;
+                for (int i = 0; i < n; ++i) {
+                    if (!pass[i]) continue;
+                    ReportRow row;
+                    row.key = id[i];
+                    row.value = count ? 1 : holds[i];
+                    if (row.value == 0) continue;
+                    if (q_.topK > 0) offer(out.rows, row, q_.topK);
+                    else out.rows.append(row);
+                }
+                break;
+            }
+        }
+    }
+
+private:
+    const ReportTable& t_;
+    const ReportQuery& q_;
+    quint8 acceptType_[256];
+    quint8 acceptStatus_[256];
+    qint64 todayJd_;
+};
+
+// A thread's run of chunks, [begin, end) packed into one word so the owner
+// (taking from the front) and thieves (taking the back half) agree by CAS.
+// One cache line each, so owners don't slow each other down.
+struct alignas(64) Run {
+    std::atomic<quint64> span{0};
+    static quint64 pack(quint32 b, quint32 e) { return (quint64(b) << 32) | e; }
+    static quint32 begin(quint64 s) { return quint32(s >> 32); }
+    static quint32 end(quint64 s)   { return quint32(s); }
+
+    bool takeFront(quint32* chunk) {
+        quint64 s = span.load();
+        while (begin(s) < end(s))
+            if (span.compare_exchange_weak(s, pack(begin(s) + 1, end(s)))) { *chunk = begin(s); return true; }
+        return false;
+    }
+    bool stealHalf(quint32* b, quint32* e) {
+        quint64 s = span.load();
+        while (begin(s) < end(s)) {
+            const quint32 take = (end(s) - begin(s) + 1) / 2;
+            if (span.compare_exchange_weak(s, pack(begin(s), end(s) - take))) {
+                *b = end(s) - take;
+                *e = end(s);
+                return true;
+            }
+        }
+        return false;
+    }
+    quint32 remaining() const {
+        const quint64 s = span.load(std::memory_order_relaxed);
+        return begin(s) < end(s) ? end(s) - begin(s) : 0;
+    }
+};
+
+void work(int self, std::vector<Run>& runs, const Scan& scan, Partial& out) {
+    Run& mine = runs[self];
+    for (;;) {
+        quint32 c;
+        if (mine.takeFront(&c)) {
+            scan.chunk(int(c), out);
+            continue;
+        }
+        // Dry: steal from whoever has the most left.
+        int victim = -1;
+        quint32 most = 0;
+        for (int v = 0; v < int(runs.size()); ++v) {
+            const quint32 left = v == self ? 0 : runs[v].remaining();
+            if (left > most) { most = left; victim = v; }
+        }
+        if (victim < 0) return;      // nothing left anywhere; no new work appears
+        quint32 b, e;
+        if (runs[victim].stealHalf(&b, &e)) mine.span.store(Run::pack(b, e));
+    }
+}
+
+} // namespace
+
+ReportEngine::ReportEngine(int threads)
+    : threads_(qMax(1, threads > 0 ? threads : QThread::idealThreadCount())) {}
+
+QVector<ReportRow> ReportEngine::run(const ReportTable& table, const ReportQuery& q) const {
+    const Scan scan(table, q);
+    const int chunks = (table.size() + kChunk - 1) / kChunk;
+    const int n = qMax(1, qMin(threads_, chunks));
+
+    std::vector<Run> runs(n);
+    for (int w = 0; w < n; ++w)
+        runs[w].span.store(Run::pack(quint32(qint64(chunks) * w / n), quint32(qint64(chunks) * (w + 1) / n)));
+    std::vector<Partial> partials(n);
+    if (n == 1) {
+        work(0, runs, scan, partials[0]);
+    } else {
+        std::vector<std::thread> pool;
+        for (int w = 1; w < n; ++w)
+            pool.emplace_back(work, w, std::ref(runs), std::cref(scan), std::ref(partials[w]));
+        work(0, runs, scan, partials[0]);
+        for (auto& t : pool) t.join();
+    }
+
+    // Merge.
+    QVector<ReportRow> out;
+    switch (q.groupBy) {
+        case ReportQuery::ByType:
+        case ReportQuery::ByStatus: {
+            const int groups = q.groupBy == ReportQuery::ByType ? kItemTypeCount : 2;
+            for (int g = 0; g < groups; ++g) {
+                ReportRow row;
+                row.key = g;
+                for (const auto& p : partials) row.value += p.small[g];
+                if (row.value) out.append(row);
+            }
+            break;
+        }
+        case ReportQuery::ByBorrower: {
+            QHash<qint64, qint64> groups = partials[0].groups;
+            for (int w = 1; w < n; ++w)
+                for (auto g = partials[w].groups.cbegin(); g != partials[w].groups.cend(); ++g)
+                    groups[g.key()] += g.value();
+            out.reserve(groups.size());
+            for (auto g = groups.cbegin(); g != groups.cend(); ++g) {
+                ReportRow row;
+                row.key = g.key();
+                row.value = g.value();
+                if (row.value) out.append(row);
+            }
+            break;
+        }
+        case ReportQuery::ByItem:
+            for (const auto& p : partials) out += p.rows;
+            break;
+    }
+
+    if (q.topK > 0) {
+        const int k = qMin(q.topK, int(out.size()));
+        std::partial_sort(out.begin(), out.begin() + k, out.end(), byValueDesc);
+        out.resize(k);
+    } else {
+        std::sort(out.begin(), out.end(), [](const ReportRow& a, const ReportRow& b){ return a.key < b.key; });
+    }
+    return out;
+}
@@ -0,0 +1,73 @@
+#ifndef REPORTENGINE_H
+#define REPORTENGINE_H
+
+#include <QDate>
+#include <QVector>
+#include "item.h"
+
+class CatalogueSnapshot;
+
+// The item fields reports aggregate over, one dense column each, so scans
+// stream through memory and the counting loops vectorize. Build one from a
+// snapshot (consistent even while circulation runs) and reuse it for as
+// many reports as wanted.
+struct ReportTable {
+    QVector<int>    id;
+    QVector<quint8> type;
+    QVector<quint8> status;
+    QVector<int>    borrowerId;
+    QVector<qint64> due;        // julian day; kNoDay if none
+    QVector<int>    holds;      // hold queue length
+
+    static const qint64 kNoDay;
+
+    int size() const { return id.size(); }
+    void reserve(int n);
+    void append(const Item& it);
+
+    static ReportTable from(const CatalogueSnapshot& snap);
+};
+
+// Filter, then group, then aggregate, then optionally keep the top k.
+struct ReportQuery {
+    enum Key { ByType, ByStatus, ByBorrower, ByItem };
+    enum Measure { Count, HoldQueueLength };
+
+    // Filter: every condition must hold.
+    quint32 typeMask = 0xffffffffu;   // bit (1 << int(ItemType)) per accepted type
+    int status = -1;                  // an Availability, or -1 for any
+    bool overdueOnly = false;         // checked out and due before `today`
+    QDate today;
+
+    Key groupBy = ByType;
+    Measure measure = Count;          // summed per group
+    int topK = 0;                     // 0: every group, by key; else the k largest
+
+    static ReportQuery loansPerType();
+    static ReportQuery longestHoldQueues(int k);
+    static ReportQuery overdueByPatron(const QDate& today, int k = 0);
+};
+
+// One group: the key (an ItemType, Availability, user id or item id) and
+// its total. Groups whose total is 0 are left out.
+struct ReportRow {
+    qint64 key = 0;
+    qint64 value = 0;
+};
+
+// Runs reports as parallel partitioned scans. Rows are cut into chunks and
+// dealt out in contiguous runs, one per thread; a thread that runs dry
+// steals half of the largest remaining run it finds, so a slow core or a
+// skewed filter doesn't leave the others idle.
+class ReportEngine {
+public:
+    explicit ReportEngine(int threads = 0);   // 0: one per core
+    int threads() const { return threads_; }
+
+    QVector<ReportRow> run(const ReportTable& table, const ReportQuery& q) const;
+
+private:
+    int threads_;
+};
+
+#endif // REPORTENGINE_H
@@ -0,0 +1,247 @@
+#include "rowbitmap.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+static quint16 keyOf(quint32 row) { return quint16(row >> 16); }
+static quint16 lowOf(quint32 row) { return quint16(row & 0xFFFF); }
+static bool test(const quint64* bits, quint16 low) { return bits[low >> 6] & (quint64(1) << (low & 63)); }
+
+int RowBitmap::find(quint16 key) const {
+    int lo = 0, hi = blocks_.size();
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (blocks_.at(mid).key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < blocks_.size() && blocks_.at(lo).key == key) ? lo : -lo - 1;
+}
+
+void RowBitmap::makeDense(Block& b) {
+    b.bits.fill(0, kWords);
+    for (quint16 low : b.sparse) b.bits[low >> 6] |= quint64(1) << (low & 63);
+    b.sparse.clear();
+    b.sparse.squeeze();
+}
+
+void RowBitmap::makeSparse(Block& b) {
+    b.sparse.clear();
+    b.sparse.reserve(b.count);
+    for (int w = 0; w < kWords; ++w) {
+        for (quint64 word = b.bits.at(w); word; word &= word - 1)
+            b.sparse.append(quint16(w * 64 + qCountTrailingZeroBits(word)));
+    }
+    b.bits.clear();
+    b.bits.squeeze();
+}
+
+void RowBitmap::add(quint32 row) {
+    int at = find(keyOf(row));
+    if (at < 0) {
+        at = -at - 1;
+        Block b;
+        b.key = keyOf(row);
+        blocks_.insert(at, b);
+    }
+    Block& b = blocks_[at];
+    const quint16 low = lowOf(row);
+    if (b.dense()) {
+        quint64& word = b.bits[low >> 6];
+        const quint64 bit = quint64(1) << (low & 63);
+        if (word & bit) return;
+        word |= bit;
+        ++b.count;
+        return;
+    }
+    // Rows are mostly added in increasing order, so this is usually an append.
+    if (b.sparse.isEmpty() || b.sparse.last() < low) {
+        b.sparse.append(low);
+    } else {
+        auto pos = std::lower_bound(b.sparse.begin(), b.sparse.end(), low);
+        if (*pos == low) return;
+        b.sparse.insert(pos, low);
+    }
+    if (++b.count > kMaxSparse) makeDense(b);
+}
+
+void RowBitmap::remove(quint32 row) {
+    const int at = find(keyOf(row));
+    if (at < 0) return;
+    Block& b = blocks_[at];
+    const quint16 low = lowOf(row);
+    if (b.dense()) {
+        quint64& word = b.bits[low >> 6];
+        const quint64 bit = quint64(1) << (low & 63);
+        if (!(word & bit)) return;
+        word &= ~bit;
+        // Go back to sparse well below the threshold so a block sitting on it
+        // doesn't flip on every add/remove.
+        if (--b.count <= kMaxSparse / 2) makeSparse(b);
+    } else {
+        auto pos = std::lower_bound(b.sparse.begin(), b.sparse.end(), low);
+        if (pos == b.sparse.end() || *pos != low) return;
+        b.sparse.erase(pos);
+        --b.count;
+    }
+    if (b.count == 0) blocks_.removeAt(at);
+}
+
+bool RowBitmap::contains(quint32 row) const {
+    const int at = find(keyOf(row));
+    if (at < 0) return false;
+    const Block& b = blocks_.at(at);
+    const quint16 low = lowOf(row);
+    if (b.dense()) return test(b.bits.constData(), low);
+    return std::binary_search(b.sparse.begin(), b.sparse.end(), low);
+}
+
+int RowBitmap::count() const {
+    int n = 0;
+    for (const auto& b : blocks_) n += b.count;
+    return n;
+}
+
+RowBitmap::Block RowBitmap::intersect(const Block& a, const Block& b) {
+    Block out;
+    out.key = a.key;
+    if (a.dense() && b.dense()) {
+        out.bits.resize(kWords);
+        const quint64* x = a.bits.constData();
+        const quint64* y = b.bits.constData();
+        quint64* z = out.bits.data();
+        for (int w = 0; w < kWords; ++w) {
+            z[w] = x[w] & y[w];
+            out.count += qPopulationCount(z[w]);
+        }
+        if (out.count <= kMaxSparse) makeSparse(out);
+        return out;
+    }
+    const Block& s = a.dense() ? b : (b.dense() || a.count <= b.count) ? a : b;
+    const Block& other = &s == &a ? b : a;
+    out.sparse.reserve(s.count);
+    if (other.dense()) {
+        const quint64* bits = other.bits.constData();
+        for (quint16 low : s.sparse) if (test(bits, low)) out.sparse.append(low);
+    } else if (s.count * 16 < other.count) {
+        for (quint16 low : s.sparse)
+            if (std::binary_search(other.sparse.begin(), other.sparse.end(), low)) out.sparse.append(low);
+    } else {
+        // A merge of two similar-sized arrays mispredicts on every other
+        // step; probing a scratch bitset of the larger one doesn't.
+        quint64 probe[kWords] = {};
+        for (quint16 low : other.sparse) probe[low >> 6] |= quint64(1) << (low & 63);
+        for (quint16 low : s.sparse) if (test(probe, low)) out.sparse.append(low);
+    }
+    out.count = out.sparse.size();
+    return out;
+}
+
+void RowBitmap::unite(Block& a, const Block& b) {
+    if (!a.dense() && !b.dense() && a.count + b.count <= kMaxSparse) {
+        QVector<quint16> merged;
+        merged.reserve(a.count + b.count);
+        std::set_union(a.sparse.begin(), a.sparse.end(), b.sparse.begin(), b.sparse.end(),
+                       std::back_inserter(merged));
+        a.sparse.swap(merged);
+        a.count = a.sparse.size();
+        return;
+    }
+    if (!a.dense()) makeDense(a);
+    quint64* z = a.bits.data();
+    if (b.dense()) {
+        const quint64* y = b.bits.constData();
+        for (int w = 0; w < kWords; ++w) z[w] |= y[w];
+    } else {
+        for (quint16 low : b.sparse) z[low >> 6] |= quint64(1) << (low & 63);
+    }
+    a.count = 0;
+    for (int w = 0; w < kWords; ++w) a.count += qPopulationCount(z[w]);
+    if (a.count <= kMaxSparse / 2) makeSparse(a);
+}
+
+int RowBitmap::intersectCount(const Block& a, const Block& b) {
+    int n = 0;
+    if (a.dense() && b.dense()) {
+        const quint64* x = a.bits.constData();
+        const quint64* y = b.bits.constData();
+        for (int w = 0; w < kWords; ++w) n += qPopulationCount(x[w] & y[w]);
+        return n;
+    }
+    const Block& s = a.dense() ? b : (b.dense() || a.count <= b.count) ? a : b;
+    const Block& other = &s == &a ? b : a;
+    if (other.dense()) {
+        const quint64* bits = other.bits.constData();
+        for (quint16 low : s.sparse) n += test(bits, low);
+    } else if (s.count * 16 < other.count) {
+        for (quint16 low : s.sparse) n += std::binary_search(other.sparse.begin(), other.sparse.end(), low);
+    } else {
+        quint64 probe[kWords] = {};
+        for (quint16 low : other.sparse) probe[low >> 6] |= quint64(1) << (low & 63);
+        for (quint16 low : s.sparse) n += test(probe, low);
+    }
+    return n;
+}
+
+RowBitmap& RowBitmap::operator&=(const RowBitmap& other) {
+    QVector<Block> out;
+    int i = 0, j = 0;
+    while (i < blocks_.size() && j < other.blocks_.size()) {
+        const Block& a = blocks_.at(i);
+        const Block& b = other.blocks_.at(j);
+        if (a.key < b.key) ++i;
+        else if (b.key < a.key) ++j;
+        else {
+            Block both = intersect(a, b);
+            if (both.count) out.append(both);
+            ++i; ++j;
+        }
+    }
+    blocks_.swap(out);
+    return *this;
+}
+
+RowBitmap& RowBitmap::operator|=(const RowBitmap& other) {
+    QVector<Block> out;
+    out.reserve(blocks_.size() + other.blocks_.size());
+    int i = 0, j = 0;
+    while (i < blocks_.size() || j < other.blocks_.size()) {
+        if (j == other.blocks_.size() || (i < blocks_.size() && blocks_.at(i).key < other.blocks_.at(j).key)) {
+            out.append(blocks_.at(i++));
+        } else if (i == blocks_.size() || other.blocks_.at(j).key < blocks_.at(i).key) {
+            out.append(other.blocks_.at(j++));
+        } else {
+            out.append(blocks_.at(i++));
+            unite(out.last(), other.blocks_.at(j++));
+        }
+    }
+    blocks_.swap(out);
+    return *this;
+}
+
+int RowBitmap::intersectionCount(const RowBitmap& a, const RowBitmap& b) {
+    int n = 0, i = 0, j = 0;
+    while (i < a.blocks_.size() && j < b.blocks_.size()) {
+        const Block& x = a.blocks_.at(i);
+        const Block& y = b.blocks_.at(j);
+        if (x.key < y.key) ++i;
+        else if (y.key < x.key) ++j;
+        else { n += intersectCount(x, y); ++i; ++j; }
+    }
+    return n;
+}
+
+QVector<quint32> RowBitmap::rows() const {
+    QVector<quint32> out;
+    out.reserve(count());
+    for (const auto& b : blocks_) {
+        const quint32 base = quint32(b.key) << 16;
+        if (!b.dense()) {
+            for (quint16 low : b.sparse) out.append(base | low);
+            continue;
+        }
+        for (int w = 0; w < kWords; ++w) {
+            for (quint64 word = b.bits.at(w); word; word &= word - 1)
+                out.append(base | quint32(w * 64 + qCountTrailingZeroBits(word)));
+        }
+    }
+    return out;
+}
@@ -0,0 +1,50 @@
+#ifndef ROWBITMAP_H
+#define ROWBITMAP_H
+
+#include <QVector>
+
+// Compressed set of row numbers, roaring-style. Rows are split into blocks of
+// 65536 by their high 16 bits; a sparse block keeps the low bits as a sorted
+// array, a dense one (over kMaxSparse rows) as a 1024-word bitset. Set
+// operations and counts go block by block, so a facet over a million rows is
+// a few dozen blocks and a combined query a few thousand word ANDs.
+class RowBitmap {
+public:
+    void add(quint32 row);
+    void remove(quint32 row);
+    bool contains(quint32 row) const;
+    int  count() const;
+    bool isEmpty() const { return blocks_.isEmpty(); }
+    void clear() { blocks_.clear(); }
+
+    RowBitmap& operator&=(const RowBitmap& other);
+    RowBitmap& operator|=(const RowBitmap& other);
+
+    // |a & b| without building the intersection.
+    static int intersectionCount(const RowBitmap& a, const RowBitmap& b);
+
+    QVector<quint32> rows() const;   // ascending
+
+private:
+    static const int kMaxSparse = 4096;   // a sparse block this full is as big as a dense one
+    static const int kWords = 1024;
+
+    struct Block {
+        quint16 key = 0;
+        int count = 0;
+        QVector<quint16> sparse;     // sorted low bits, while bits is empty
+        QVector<quint64> bits;       // kWords words once dense
+        bool dense() const { return !bits.isEmpty(); }
+    };
+
+    int find(quint16 key) const;     // index, or -(insertion point) - 1
+    static void makeDense(Block& b);
+    static void makeSparse(Block& b);
+    static Block intersect(const Block& a, const Block& b);
+    static void unite(Block& a, const Block& b);
+    static int intersectCount(const Block& a, const Block& b);
+
+    QVector<Block> blocks_;          // ascending key
+};
+
+#endif // ROWBITMAP_H
@@ -0,0 +1,149 @@
+#include "searchindex.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+// Merge two ascending id lists, dropping duplicates.
+static QVector<int> unite(const QVector<int>& a, const QVector<int>& b) {
+    QVector<int> out;
+    out.reserve(a.size() + b.size());
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+static QVector<int> intersect(const QVector<int>& a, const QVector<int>& b) {
+    QVector<int> out;
+    out.reserve(qMin(a.size(), b.size()));
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+QStringList SearchIndex::tokenize(const QString& text) {
+    QStringList out;
+    QString cur;
+    for (QChar c : text) {
+        if (c.isLetterOrNumber()) {
+            cur += c.toLower();
+        } else if (!cur.isEmpty()) {
+            out.append(cur);
+            cur.clear();
+        }
+    }
+    if (!cur.isEmpty()) out.append(cur);
+    return out;
+}
+
+QStringList SearchIndex::tokensOf(const Item& it) {
+    QStringList all;
+    all << tokenize(it.title) << tokenize(it.creator) << tokenize(it.genre)
+        << tokenize(it.dewey) << tokenize(it.issue);
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+    return all;
+}
+
+void SearchIndex::clear() {
+    postings_.clear();
+    itemTokens_.clear();
+    maxId_ = -1;
+    negativeIds_ = false;
+}
+
+void SearchIndex::rebuild(const QList<Item>& items) {
+    clear();
+    itemTokens_.reserve(items.size());
+    for (const auto& it : items) add(it);
+}
+
+void SearchIndex::add(const Item& it) {
+    if (itemTokens_.contains(it.id)) remove(it.id);
+    const QStringList tokens = tokensOf(it);
+    for (const auto& t : tokens) {
+        QVector<int>& list = postings_[t];
+        // Ids are usually handed out in increasing order, so this is an append.
+        if (list.isEmpty() || list.last() < it.id) list.append(it.id);
+        else list.insert(std::lower_bound(list.begin(), list.end(), it.id), it.id);
+    }
+    itemTokens_.insert(it.id, tokens);
+    maxId_ = qMax(maxId_, it.id);
+    negativeIds_ = negativeIds_ || it.id < 0;
+}
+
+void SearchIndex::remove(int itemId) {
+    auto found = itemTokens_.find(itemId);
+    if (found == itemTokens_.end()) return;
+    for (const auto& t : found.value()) {
+        auto p = postings_.find(t);
+        if (p == postings_.end()) continue;
+        QVector<int>& list = p.value();
+        auto at = std::lower_bound(list.begin(), list.end(), itemId);
+        if (at != list.end() && *at == itemId) list.erase(at);
+        if (list.isEmpty()) postings_.erase(p);
+    }
+    itemTokens_.erase(found);
+}
+
+void SearchIndex::update(const Item& it) {
+    auto found = itemTokens_.constFind(it.id);
+    if (found != itemTokens_.constEnd() && found.value() == tokensOf(it)) return;
+    add(it);
+}
+
+QVector<int> SearchIndex::prefixPostings(const QString& prefix) const {
+    auto first = postings_.lowerBound(prefix);
+    auto last = first;
+    int lists = 0;
+    qint64 total = 0;
+    while (last != postings_.constEnd() && last.key().startsWith(prefix)) { total += last.value().size(); ++last; ++lists; }
+    if (lists == 0) return QVector<int>();
+    if (lists == 1) return first.value();
+    if (lists == 2) {
+        auto second = first;
+        ++second;
+        return unite(first.value(), second.value());
+    }
+
+    // A few short lists: concatenate once and sort.
+    const int words = maxId_ / 64 + 1;
+    if (total < words || negativeIds_) {
+        QVector<int> out;
+        out.reserve(int(total));
+        for (auto p = first; p != last; ++p) out += p.value();
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+
+    // A wide prefix (the first keystrokes): mark every id in a bitmap and
+    // read it back in order, linear in the postings instead of a sort over
+    // them.
+    QVector<quint64> bits(words, 0);
+    quint64* b = bits.data();
+    for (auto p = first; p != last; ++p)
+        for (int id : p.value()) b[id >> 6] |= quint64(1) << (id & 63);
+    QVector<int> out;
+    out.reserve(int(qMin<qint64>(total, maxId_ + 1)));
+    for (int w = 0; w < words; ++w) {
+        for (quint64 word = b[w]; word; word &= word - 1)
+            out.append(w * 64 + qCountTrailingZeroBits(word));
+    }
+    return out;
+}
+
+QVector<int> SearchIndex::search(const QString& query) const {
+    QStringList terms = tokenize(query);
+    if (terms.isEmpty()) return QVector<int>();
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    // Longer terms tend to be more selective; start with them so the
+    // running intersection shrinks early.
+    std::sort(terms.begin(), terms.end(), [](const QString& a, const QString& b){ return a.size() > b.size(); });
+
+    QVector<int> result;
+    for (int i = 0; i < terms.size(); ++i) {
+        const QVector<int> hits = prefixPostings(terms.at(i));
+        result = (i == 0) ? hits : intersect(result, hits);
+        if (result.isEmpty()) break;
+    }
+    return result;
+}
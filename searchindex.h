@@ -0,0 +1,38 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include "item.h"
+
+// Inverted index over the text patrons search by: title, creator, genre,
+// dewey and issue. Each normalized token maps to a sorted posting list of
+// item ids. Tokens are kept ordered so a prefix is a contiguous key range.
+class SearchIndex {
+public:
+    void clear();
+    void rebuild(const QList<Item>& items);
+    void add(const Item& it);
+    void remove(int itemId);
+    void update(const Item& it);   // no-op unless the item's tokens changed
+
+    // Ids (ascending) of items matching every term of the query. Terms match
+    // token prefixes, so results narrow as the user types.
+    QVector<int> search(const QString& query) const;
+
+    // Lower-cased runs of letters/digits; "510.9" -> "510", "9".
+    static QStringList tokenize(const QString& text);
+    static QStringList tokensOf(const Item& it);
+
+private:
+    QVector<int> prefixPostings(const QString& prefix) const;
+
+    QMap<QString, QVector<int> > postings_;
+    QHash<int, QStringList> itemTokens_;   // item id -> its distinct tokens
+    int maxId_ = -1;                       // highest id ever added; sizes the prefix bitmap
+    bool negativeIds_ = false;             // ...which then can't hold every id
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,93 @@
+#include "circulationserver.h"
+#include "catalogue.h"
+#include "librarycontroller.h"
+#include <QLocalSocket>
+
+CirculationServer::CirculationServer(Catalogue* cat, LibraryController* lib, QObject* parent)
+    : QObject(parent), cat_(cat), lib_(lib)
+{
+    server_.setMaxPendingConnections(1024);
+    connect(&server_, &QLocalServer::newConnection, this, &CirculationServer::onNewConnection);
+}
+
+bool CirculationServer::listen(const QString& name) {
+    QLocalServer::removeServer(name);   // stale socket file from a crash
+    return server_.listen(name);
+}
+
+void CirculationServer::onNewConnection() {
+    while (QLocalSocket* client = server_.nextPendingConnection()) {
+        inbox_.insert(client, QByteArray());
+        client->setReadBufferSize(kReadBuffer);
+        connect(client, &QLocalSocket::readyRead, this, [this, client]{ serve(client); });
+        connect(client, &QLocalSocket::bytesWritten, this, [this, client]{
+            if (paused_.contains(client) && client->bytesToWrite() <= kMaxUnsent / 2) {
+                paused_.remove(client);
+                serve(client);   // frames left in the inbox, then the socket
+            }
+        });
+        connect(client, &QLocalSocket::disconnected, this, [this, client]{
+            inbox_.remove(client);
+            paused_.remove(client);
+            client->deleteLater();
+        });
+    }
+}
+
+void CirculationServer::serve(QLocalSocket* client) {
+    auto found = inbox_.find(client);
+    if (found == inbox_.end()) return;
+    if (paused_.contains(client)) return;   // bytesWritten resumes it
+    QByteArray& in = found.value();
+    in += client->readAll();
+
+    // Stop at the reply budget; the frames left stay in the inbox.
+    QByteArray out;
+    int offset = 0;
+    Protocol::Request req;
+    Protocol::Decode d = Protocol::NeedMore;
+    const qint64 unsent = client->bytesToWrite();
+    while (unsent + out.size() < kMaxUnsent && (d = Protocol::decode(in, &offset, &req)) == Protocol::Decoded)
+        Protocol::encode(out, execute(req));
+    in.remove(0, offset);
+
+    const bool full = unsent + out.size() >= kMaxUnsent;
+
+    if (!out.isEmpty()) client->write(out);
+    if (d == Protocol::Malformed) client->disconnectFromServer();   // after the replies so far
+    else if (full) paused_.insert(client);
+}
+
+Protocol::Reply CirculationServer::execute(const Protocol::Request& req) {
+    Result r;
+    switch (req.op) {
+        case Protocol::Borrow:        r = lib_->borrow(req.userId, req.itemId); break;
+        case Protocol::Return:        r = lib_->returnItem(req.userId, req.itemId); break;
+        case Protocol::PlaceHold:     r = lib_->placeHold(req.userId, req.itemId); break;
+        case Protocol::CancelHold:    r = lib_->cancelHold(req.userId, req.itemId); break;
+        case Protocol::CanBorrow:     r = lib_->canBorrow(req.userId, req.itemId); break;
+        case Protocol::CanReturn:     r = lib_->canReturn(req.userId, req.itemId); break;
+        case Protocol::CanPlaceHold:  r = lib_->canPlaceHold(req.userId, req.itemId); break;
+        case Protocol::CanCancelHold: r = lib_->canCancelHold(req.userId, req.itemId); break;
+        case Protocol::QueuePosition: {
+            const int pos = lib_->queuePosition(req.userId, req.itemId);
+            r = Result(pos > 0, QString(), pos);
+            break;
+        }
+        case Protocol::ItemStatus: {
+            const Item* it = cat_->findItem(req.itemId);
+            if (!it) { r = Result(false, "Invalid selection.", -1); break; }
+            r = Result(true, it->due.isValid() ? it->due.toString("yyyy-MM-dd") : QString(), it->borrowerId);
+            break;
+        }
+        default:
+            r = Result(false, "Unknown request.");
+    }
+
+    Protocol::Reply reply;
+    reply.requestId = req.requestId;
+    reply.ok = r.ok;
+    reply.aux = r.aux;
+    reply.message = r.message;
+    return reply;
+}
@@ -0,0 +1,49 @@
+#ifndef CIRCULATIONSERVER_H
+#define CIRCULATIONSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QHash>
+#include <QSet>
+#include "protocol.h"
+
+class Catalogue;
+class LibraryController;
+class QLocalSocket;
+
+// Serves LibraryController over a local (Unix domain) socket. Everything
+// runs on one event loop: each readable client has all of its complete
+// frames executed and the replies written back in a single write, so
+// pipelined requests cost one wakeup per batch rather than per request.
+//
+// A client that pipelines without reading its replies is paused once
+// kMaxUnsent reply bytes wait for it: nothing more is read or run until
+// half of them have gone, and its read buffer is capped, so the kernel
+// pushes back on its writes instead of the server's memory growing.
+class CirculationServer : public QObject {
+    Q_OBJECT
+public:
+    CirculationServer(Catalogue* cat, LibraryController* lib, QObject* parent=nullptr);
+
+    bool listen(const QString& name);
+    QString errorString() const { return server_.errorString(); }
+    int clientCount() const { return inbox_.size(); }
+
+    static const qint64 kMaxUnsent = 1 << 20;    // reply bytes per client
+    static const qint64 kReadBuffer = 64 * 1024;
+
+private slots:
+    void onNewConnection();
+
+private:
+    void serve(QLocalSocket* client);
+    Protocol::Reply execute(const Protocol::Request& req);
+
+    Catalogue* cat_;
+    LibraryController* lib_;
+    QLocalServer server_;
+    QHash<QLocalSocket*, QByteArray> inbox_;   // unparsed bytes per client
+    QSet<QLocalSocket*> paused_;               // waiting for replies to drain
+};
+
+#endif // CIRCULATIONSERVER_H
@@ -0,0 +1,18 @@
+# Headless circulation daemon: qmake server/hinlibsd.pro && make
+
+QT       = core network
+CONFIG  += console c++11
+CONFIG  -= app_bundle
+TARGET   = hinlibsd
+
+include(../core.pri)
+
+INCLUDEPATH += ../net
+
+SOURCES += \
+    circulationserver.cpp \
+    main.cpp
+
+HEADERS += \
+    ../net/protocol.h \
+    circulationserver.h
@@ -0,0 +1,134 @@
+// hinlibsd: headless circulation server. Owns the catalogue and serves
+// LibraryController over a local socket (see net/protocol.h).
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QStandardPaths>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <cstdio>
+#include "catalogue.h"
+#include "cataloguestore.h"
+#include "librarycontroller.h"
+#include "circulationserver.h"
+#include "metrics.h"
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <unistd.h>
+
+// SIGINT/SIGTERM -> write a byte to a pipe -> event loop quits cleanly and
+// the catalogue gets checkpointed.
+static int quitPipe[2];
+static void onQuitSignal(int) { char c = 1; (void)::write(quitPipe[1], &c, 1); }
+#endif
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("hinlibsd");
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription("HinLIBS headless circulation server");
+    cli.addHelpOption();
+    QCommandLineOption socketOpt("socket", "Local socket name.", "name", "hinlibs");
+    QCommandLineOption dataOpt("data", "Snapshot/journal directory.", "dir",
+                               QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    QCommandLineOption commitOpt("commit-ms", "Journal group-commit interval.", "ms", "50");
+    cli.addOption(socketOpt);
+    cli.addOption(dataOpt);
+    QCommandLineOption metricsFileOpt("metrics-file",
+        "Write metrics here every minute and at exit (.json, else Prometheus text).", "path");
+    QCommandLineOption metricsSocketOpt("metrics-socket",
+        "Local socket that answers each connection with Prometheus text.", "name");
+    cli.addOption(commitOpt);
+    cli.addOption(metricsFileOpt);
+    cli.addOption(metricsSocketOpt);
+    cli.process(app);
+
+    Catalogue cat;
+    LibraryController lib(&cat);
+    CatalogueStore store(cli.value(dataOpt));
+    if (!store.exists()) {
+        cat.seedDefaultData();
+        if (!store.checkpoint(cat)) {
+            fprintf(stderr, "hinlibsd: cannot write to %s: %s\n",
+                    qPrintable(cli.value(dataOpt)), qPrintable(store.lastError()));
+            return 1;
+        }
+    } else if (!store.open(cat, lib)) {
+        // Leave an unreadable snapshot or journal alone rather than seed over it.
+        fprintf(stderr, "hinlibsd: cannot load %s: %s\n",
+                qPrintable(cli.value(dataOpt)), qPrintable(store.lastError()));
+        return 1;
+    }
+    store.journal()->setFailureHandler([](const QString& error) {
+        fprintf(stderr, "hinlibsd: journal commit failed, retrying: %s\n", qPrintable(error));
+    });
+    lib.setJournal(store.journal());
+
+    // Group commits happen on the journal's own thread, off the event loop.
+    store.journal()->startFlusher(cli.value(commitOpt).toInt());
+
+    // Once a minute: flag overdue loans and let lapsed pickup holds go.
+    QTimer due;
+    const QString metricsFile = cli.value(metricsFileOpt);
+    QObject::connect(&due, &QTimer::timeout, [&lib, &metricsFile]{
+        if (!metricsFile.isEmpty()) Metrics::writeTo(metricsFile);
+        int overdue = 0, lapsed = 0;
+        for (const auto& ev : lib.runDueEvents())
+            ++(ev.kind == DueScheduler::LoanDue ? overdue : lapsed);
+        if (overdue || lapsed) {
+            printf("hinlibsd: %d loans now overdue, %d hold pickups lapsed\n", overdue, lapsed);
+            fflush(stdout);
+        }
+    });
+    due.start(60 * 1000);
+
+    CirculationServer server(&cat, &lib);
+    if (!server.listen(cli.value(socketOpt))) {
+        fprintf(stderr, "hinlibsd: %s\n", qPrintable(server.errorString()));
+        return 1;
+    }
+    printf("hinlibsd: serving %d items / %d users on '%s'\n",
+           int(cat.items.size()), int(cat.users.size()), qPrintable(cli.value(socketOpt)));
+    fflush(stdout);
+
+    // Scrape endpoint: connect, read to EOF, e.g. `socat - UNIX-CONNECT:<path>`.
+    QLocalServer metricsServer;
+    if (cli.isSet(metricsSocketOpt)) {
+        const QString name = cli.value(metricsSocketOpt);
+        QLocalServer::removeServer(name);
+        if (!metricsServer.listen(name)) {
+            fprintf(stderr, "hinlibsd: metrics socket: %s\n", qPrintable(metricsServer.errorString()));
+            return 1;
+        }
+        QObject::connect(&metricsServer, &QLocalServer::newConnection, [&metricsServer]{
+            while (QLocalSocket* peer = metricsServer.nextPendingConnection()) {
+                QObject::connect(peer, &QLocalSocket::disconnected, peer, &QObject::deleteLater);
+                peer->write(Metrics::toPrometheus());
+                peer->disconnectFromServer();
+            }
+        });
+    }
+
+#ifdef Q_OS_UNIX
+    if (::pipe(quitPipe) == 0) {
+        auto* quitNotifier = new QSocketNotifier(quitPipe[0], QSocketNotifier::Read, &app);
+        QObject::connect(quitNotifier, &QSocketNotifier::activated, &app, &QCoreApplication::quit);
+        std::signal(SIGINT, onQuitSignal);
+        std::signal(SIGTERM, onQuitSignal);
+    }
+#endif
+
+    const int rc = app.exec();
+    lib.setJournal(nullptr);
+    store.checkpoint(cat);
+    if (!metricsFile.isEmpty()) {
+        QString error;
+        if (!Metrics::writeTo(metricsFile, &error))
+            fprintf(stderr, "hinlibsd: cannot write %s: %s\n", qPrintable(metricsFile), qPrintable(error));
+    }
+    return rc;
+}
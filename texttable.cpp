@@ -0,0 +1,15 @@
+#include "texttable.h"
+
+quint32 TextTable::intern(const QString& s) {
+    auto found = handles_.constFind(s);
+    if (found != handles_.constEnd()) return found.value();
+    const quint32 h = quint32(strings_.size());
+    strings_.append(s);
+    handles_.insert(s, h);
+    return h;
+}
+
+void TextTable::clear() {
+    strings_.clear();
+    handles_.clear();
+}
@@ -0,0 +1,25 @@
+#ifndef TEXTTABLE_H
+#define TEXTTABLE_H
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+
+// Interning pool for catalogue text: each distinct value is stored once.
+// intern() hands out a 32-bit handle (for column stores); shared() hands out
+// the pooled QString itself, so equal fields share one implicitly-shared
+// buffer instead of each owning a copy.
+class TextTable {
+public:
+    quint32 intern(const QString& s);
+    QString shared(const QString& s) { return s.isEmpty() ? s : at(intern(s)); }
+    const QString& at(quint32 h) const { return strings_.at(int(h)); }
+    int size() const { return strings_.size(); }
+    void clear();
+
+private:
+    QVector<QString> strings_;
+    QHash<QString, quint32> handles_;
+};
+
+#endif // TEXTTABLE_H
@@ -0,0 +1,11 @@
+# Local load generator for hinlibsd: qmake tools/loadgen/loadgen.pro && make
+
+QT       = core network
+CONFIG  += console c++11
+CONFIG  -= app_bundle
+TARGET   = loadgen
+
+include(../../net/net.pri)
+
+SOURCES += \
+    main.cpp
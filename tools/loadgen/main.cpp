@@ -0,0 +1,104 @@
+// loadgen: drives a running hinlibsd with many pipelined clients and
+// reports throughput and latency percentiles.
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+#include <QList>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include "circulationclient.h"
+
+namespace {
+
+struct Session {
+    CirculationClient* client = nullptr;
+    QHash<quint32, qint64> sentAt;     // request id -> ns
+    std::mt19937 rng;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription("Load generator for hinlibsd");
+    cli.addHelpOption();
+    QCommandLineOption socketOpt("socket", "Server socket name.", "name", "hinlibs");
+    QCommandLineOption clientsOpt("clients", "Concurrent connections.", "n", "64");
+    QCommandLineOption requestsOpt("requests", "Total requests to send.", "n", "200000");
+    QCommandLineOption depthOpt("depth", "Requests in flight per connection.", "n", "16");
+    QCommandLineOption usersOpt("users", "Patron ids 1..n.", "n", "5");
+    QCommandLineOption firstItemOpt("first-item", "Lowest item id.", "id", "100");
+    QCommandLineOption itemsOpt("items", "Number of item ids.", "n", "20");
+    cli.addOptions({socketOpt, clientsOpt, requestsOpt, depthOpt, usersOpt, firstItemOpt, itemsOpt});
+    cli.process(app);
+
+    const int clients   = qMax(1, cli.value(clientsOpt).toInt());
+    const qint64 total  = qMax(1LL, cli.value(requestsOpt).toLongLong());
+    const int depth     = qMax(1, cli.value(depthOpt).toInt());
+    const int users     = qMax(1, cli.value(usersOpt).toInt());
+    const int firstItem = cli.value(firstItemOpt).toInt();
+    const int items     = qMax(1, cli.value(itemsOpt).toInt());
+
+    static const Protocol::Op kMix[] = {
+        Protocol::Borrow, Protocol::Return, Protocol::PlaceHold, Protocol::CancelHold,
+        Protocol::CanBorrow, Protocol::QueuePosition, Protocol::ItemStatus
+    };
+
+    QElapsedTimer clock;
+    qint64 sent = 0, done = 0;
+    QVector<qint64> latencies;
+    latencies.reserve(int(total));
+    QList<Session*> sessions;
+
+    auto pump = [&](Session* s) {
+        while (s->client->outstanding() < depth && sent < total) {
+            const Protocol::Op op = kMix[s->rng() % (sizeof(kMix) / sizeof(kMix[0]))];
+            const int user = 1 + int(s->rng() % quint32(users));
+            const int item = firstItem + int(s->rng() % quint32(items));
+            s->sentAt.insert(s->client->submit(op, user, item), clock.nsecsElapsed());
+            ++sent;
+        }
+        s->client->flush();
+    };
+
+    for (int i = 0; i < clients; ++i) {
+        auto* s = new Session;
+        s->client = new CirculationClient(&app);
+        s->rng.seed(quint32(i + 1));
+        if (!s->client->connectToServer(cli.value(socketOpt))) {
+            fprintf(stderr, "loadgen: cannot connect to '%s'\n", qPrintable(cli.value(socketOpt)));
+            return 1;
+        }
+        QObject::connect(s->client, &CirculationClient::replied, [&, s](const Protocol::Reply& r){
+            latencies.append(clock.nsecsElapsed() - s->sentAt.take(r.requestId));
+            if (++done == total) app.quit();
+            else pump(s);
+        });
+        QObject::connect(s->client, &CirculationClient::disconnected, &app, &QCoreApplication::quit);
+        sessions.append(s);
+    }
+
+    clock.start();
+    for (Session* s : sessions) pump(s);
+    app.exec();
+    const double secs = clock.nsecsElapsed() / 1e9;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) -> double {
+        if (latencies.isEmpty()) return 0;
+        const int at = qMin(latencies.size() - 1, int(p * latencies.size()));
+        return latencies.at(at) / 1000.0;
+    };
+    printf("requests=%lld clients=%d depth=%d seconds=%.3f throughput=%.0f/s "
+           "p50_us=%.1f p99_us=%.1f p999_us=%.1f\n",
+           done, clients, depth, secs, done / secs, pct(0.50), pct(0.99), pct(0.999));
+
+    qDeleteAll(sessions);
+    return done == total ? 0 : 1;
+}
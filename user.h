@@ -14,7 +14,9 @@ public:
     QList<int> loans;   // item IDs
     QList<int> holds;   // item IDs
 
-    // Keep 'why': guard against duplicates to keep UI consistent.
+    // For building users by hand; they ignore duplicates so the lists stay
+    // clean. Circulation goes through Catalogue::link() and unlink(), which
+    // keep these lists and the relation index together.
     void addLoan(int itemId)        { if (!loans.contains(itemId)) loans.append(itemId); }
     bool removeLoan(int itemId)     { return loans.removeAll(itemId) > 0; }
     bool hasLoan(int itemId)  const { return loans.contains(itemId); }